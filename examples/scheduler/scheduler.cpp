@@ -7,61 +7,112 @@
 
 #include "ecoro/sync_wait.hpp"
 
-#include <thread>
+#include <optional>
+#include <utility>
 
 namespace ecoro::sts {
 
-bool scheduler::timer_awaiter::await_ready() const noexcept {
-  const auto now = std::chrono::steady_clock::now();
-  return when < now;
+scheduler::scheduler(const std::size_t spin_count) noexcept
+    : parker_(spin_count) {
 }
 
-bool scheduler::timer_awaiter::await_suspend(
-    std::coroutine_handle<> awaiting_coro) noexcept {
-  handle = awaiting_coro;
-  scheduler_.add_timer_awaiter(this);
-  return true;
-}
-
-void scheduler::timer_awaiter::await_resume() const noexcept {}
-
 int scheduler::exec() {
   auto timer_task = process_timers();
   sync_wait(timer_task);
   return 1;
 }
 
-ecoro::task<void> scheduler::schedule_after(
-    const std::chrono::nanoseconds delay) noexcept {
-  co_return co_await timer_awaiter{
-    *this, std::chrono::steady_clock::now() + delay};
+void scheduler::enqueue(detail::scheduler_operation *operation) noexcept {
+  {
+    std::lock_guard lock{mutex_};
+    ready_.push_back(operation);
+  }
+
+  parker_.unpark();
 }
 
-void scheduler::add_timer_awaiter(timer_awaiter *timer) {
-  timer_awaiters_.push_back(timer);
+void scheduler::add_timer(detail::timer_operation &operation) noexcept {
+  {
+    std::lock_guard lock{mutex_};
+    if (!operation.cancelled()) {
+      operation.state_ = detail::timer_operation::state::added;
+      timers_.add(operation);
+      // The loop may sleep until a later deadline.
+      parker_.unpark();
+      return;
+    }
+  }
+
+  // Cancelled before it was added, resume it right away.
+  enqueue(&operation);
+}
+
+bool scheduler::cancel_timer(detail::timer_operation &operation) noexcept {
+  std::lock_guard lock{mutex_};
+  if (operation.state_ == detail::timer_operation::state::idle) {
+    operation.state_ = detail::timer_operation::state::cancelled;
+    return false;
+  }
+
+  if (!timers_.remove(operation)) {
+    return false;
+  }
+
+  operation.state_ = detail::timer_operation::state::cancelled;
+  return true;
 }
 
 void scheduler::shutdown() {
   running_ = false;
+  wakeup();
+}
+
+void scheduler::wakeup() noexcept {
+  parker_.unpark();
 }
 
 task<void> scheduler::process_timers() {
   while (running_) {
-    const auto now = std::chrono::steady_clock::now();
-    if (timer_awaiters_.empty()) {
-      std::this_thread::yield();
-      continue;
+    // Operations queued while running the batch wait for the next pass, so
+    // a yielding coroutine does not starve the timers.
+    detail::operation_queue ready;
+    {
+      std::lock_guard lock{mutex_};
+      ready = std::exchange(ready_, {});
+    }
+    while (auto *operation = ready.pop_front()) {
+      operation->execute();
     }
 
-    auto timer_awaiters = std::exchange(timer_awaiters_, {});
-    for (auto *timer_awaiter : timer_awaiters) {
-      if (timer_awaiter->when <= now) {
-        timer_awaiter->handle.resume();
-        if (!running_)
-          break;
+    bool idle = false;
+    std::optional<std::chrono::steady_clock::time_point> deadline;
+    {
+      std::lock_guard lock{mutex_};
+      idle = ready_.empty();
+      deadline = timers_.next_deadline();
+    }
 
-      } else {
-        timer_awaiters_.push_back(timer_awaiter);
+    if (!idle) {
+      // Do not sleep, there is work already.
+    } else if (deadline) {
+      parker_.park_until(*deadline);
+    } else {
+      parker_.park();
+    }
+
+    // Expired timers run outside the lock, they may queue more work.
+    detail::operation_queue expired;
+    {
+      std::lock_guard lock{mutex_};
+      timers_.advance(std::chrono::steady_clock::now(),
+                      [&expired](auto &timer) {
+                        expired.push_back(
+                            &static_cast<detail::timer_operation &>(timer));
+                      });
+    }
+    while (auto *operation = expired.pop_front()) {
+      if (running_) {
+        operation->execute();
       }
     }
   }
@@ -6,27 +6,28 @@
 #ifndef ECORO_EXAMPLES_SCHEDULER_SCHEDULER_HPP
 #define ECORO_EXAMPLES_SCHEDULER_SCHEDULER_HPP
 
+#include "ecoro/detail/parker.hpp"
+#include "ecoro/detail/scheduler_operation.hpp"
 #include "ecoro/scheduler.hpp"
 #include "ecoro/scope.hpp"
 #include "ecoro/task.hpp"
+#include "ecoro/timer_wheel.hpp"
 
-#include <vector>
+#include <atomic>
+#include <mutex>
 
 namespace ecoro::sts {
 
+// Runs every coroutine on the thread that calls exec(). Other threads, for
+// instance through a stop callback, may still queue work and add or cancel
+// timers, so the queue and the timers are guarded and a sleeping loop is
+// woken up.
 class scheduler : public ecoro::scheduler {
-  struct timer_awaiter {
-    bool await_ready() const noexcept;
-
-    bool await_suspend(std::coroutine_handle<> awaiting_coro) noexcept;
-    void await_resume() const noexcept;
-
-    scheduler &scheduler_;
-    std::chrono::steady_clock::time_point when;
-    std::coroutine_handle<> handle;
-  };
-
  public:
+  // The loop spins for spin_count rounds before it goes to sleep.
+  explicit scheduler(
+      std::size_t spin_count = detail::parker::default_spin_count) noexcept;
+
   template<typename Awaitable, typename... Args>
   void spawn(Awaitable &&awaitable, Args &&...args) {
     scope_.spawn(std::forward<Awaitable>(awaitable),
@@ -34,20 +35,22 @@ class scheduler : public ecoro::scheduler {
   }
 
   void shutdown();
+  void wakeup() noexcept;
   int exec();
 
-  [[nodiscard]] ecoro::task<void> schedule_after(
-      const std::chrono::nanoseconds delay) noexcept override;
-
- protected:
-  void add_timer_awaiter(timer_awaiter *timer);
+  void enqueue(detail::scheduler_operation *operation) noexcept override;
+  void add_timer(detail::timer_operation &operation) noexcept override;
+  bool cancel_timer(detail::timer_operation &operation) noexcept override;
 
  protected:
   task<void> process_timers();
 
  private:
-  bool running_{true};
-  std::vector<timer_awaiter *> timer_awaiters_;
+  std::atomic<bool> running_{true};
+  std::mutex mutex_;
+  detail::operation_queue ready_;
+  timer_wheel timers_;
+  detail::parker parker_;
   ecoro::scope scope_{this};
 };
 
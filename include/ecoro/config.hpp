@@ -14,4 +14,17 @@
   #define ECORO_NOINLINE
 #endif
 
+// Wraps a coroutine that takes std::allocator_arg. GCC 11+ pairs its frame
+// with the sized operator delete and warns, although both go through the
+// same frame header and free the block with the allocator that made it.
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+  #define ECORO_ALLOCATOR_ARG_COROUTINE_BEGIN \
+    _Pragma("GCC diagnostic push")          \
+    _Pragma("GCC diagnostic ignored \"-Wmismatched-new-delete\"")
+  #define ECORO_ALLOCATOR_ARG_COROUTINE_END _Pragma("GCC diagnostic pop")
+#else
+  #define ECORO_ALLOCATOR_ARG_COROUTINE_BEGIN
+  #define ECORO_ALLOCATOR_ARG_COROUTINE_END
+#endif
+
 #endif  // ECORO_CONFIG_HPP
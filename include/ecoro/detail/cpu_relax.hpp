@@ -0,0 +1,29 @@
+// Copyright 2022 - present, Mikhail Svetkin
+// All rights reserved.
+//
+// For the license information refer to LICENSE
+
+#ifndef ECORO_DETAIL_CPU_RELAX_HPP
+#define ECORO_DETAIL_CPU_RELAX_HPP
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#  include <intrin.h>
+#endif
+
+namespace ecoro::detail {
+
+// Hint to the CPU that we are in a spin-wait loop.
+inline void cpu_relax() noexcept {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+  _mm_pause();
+#elif (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(__x86_64__) || defined(__i386__))
+  __builtin_ia32_pause();
+#elif (defined(__GNUC__) || defined(__clang__)) && defined(__aarch64__)
+  asm volatile("yield" ::: "memory");
+#endif
+}
+
+}  // namespace ecoro::detail
+
+#endif  // ECORO_DETAIL_CPU_RELAX_HPP
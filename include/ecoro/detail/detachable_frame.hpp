@@ -0,0 +1,54 @@
+// Copyright 2022 - present, Mikhail Svetkin
+// All rights reserved.
+//
+// For the license information refer to LICENSE
+
+#ifndef ECORO_DETAIL_DETACHABLE_FRAME_HPP
+#define ECORO_DETAIL_DETACHABLE_FRAME_HPP
+
+#include "ecoro/coroutine.hpp"
+
+#include <atomic>
+
+namespace ecoro::detail {
+
+// The frame of a combinator child whose owner may let go of it while it
+// still runs, a cancelled loser that has not unwound yet for example.
+// Whichever of the owner and the finishing child comes second destroys it.
+class detachable_frame {
+ public:
+  // Before the frame is resumed for the first time.
+  void on_started() noexcept {
+    state_.store(running, std::memory_order_relaxed);
+  }
+
+  // At the final point, true if the owner is gone and the frame has to
+  // destroy itself.
+  bool on_finished() noexcept {
+    return state_.exchange(finished, std::memory_order_acq_rel) == detached;
+  }
+
+  // By the owner, true if the frame was never started or has finished, so
+  // that the owner destroys it.
+  bool detach() noexcept {
+    return state_.exchange(detached, std::memory_order_acq_rel) != running;
+  }
+
+ private:
+  enum state : unsigned char { idle, running, finished, detached };
+
+  std::atomic<state> state_{idle};
+};
+
+// Clears the handle of a child that is still running, its task then leaves
+// the frame alone.
+template<typename Promise>
+void detach_frame(std::coroutine_handle<Promise> &handle) noexcept {
+  if (handle && !handle.promise().detach()) {
+    handle = nullptr;
+  }
+}
+
+}  // namespace ecoro::detail
+
+#endif  // ECORO_DETAIL_DETACHABLE_FRAME_HPP
@@ -0,0 +1,56 @@
+// Copyright 2022 - present, Mikhail Svetkin
+// All rights reserved.
+//
+// For the license information refer to LICENSE
+
+#ifndef ECORO_DETAIL_PARKER_HPP
+#define ECORO_DETAIL_PARKER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#if !defined(__linux__)
+#  include <condition_variable>
+#  include <mutex>
+#endif
+
+namespace ecoro::detail {
+
+// Puts the calling thread to sleep until another thread calls unpark() or
+// the deadline is reached. A wakeup that comes before park() is not lost,
+// the next park() returns immediately.
+//
+// Before going to sleep the thread spins for spin_count rounds, which cuts
+// wakeup latency at the price of CPU time. On Linux the sleep is a futex
+// wait, elsewhere a condition variable.
+class parker {
+ public:
+  static constexpr std::size_t default_spin_count = 128;
+
+  explicit parker(std::size_t spin_count = default_spin_count) noexcept;
+
+  parker(const parker &) = delete;
+  parker &operator=(const parker &) = delete;
+
+  void park() noexcept;
+  void park_until(std::chrono::steady_clock::time_point deadline) noexcept;
+  void unpark() noexcept;
+
+ private:
+  bool try_park() noexcept;
+  void wait(const std::chrono::steady_clock::time_point *deadline) noexcept;
+
+  std::atomic<std::uint32_t> state_{0};
+  std::size_t spin_count_;
+
+#if !defined(__linux__)
+  std::mutex mutex_;
+  std::condition_variable cv_;
+#endif
+};
+
+}  // namespace ecoro::detail
+
+#endif  // ECORO_DETAIL_PARKER_HPP
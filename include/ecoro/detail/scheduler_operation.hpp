@@ -0,0 +1,94 @@
+// Copyright 2022 - present, Mikhail Svetkin
+// All rights reserved.
+//
+// For the license information refer to LICENSE
+
+#ifndef ECORO_DETAIL_SCHEDULER_OPERATION_HPP
+#define ECORO_DETAIL_SCHEDULER_OPERATION_HPP
+
+#include "ecoro/coroutine.hpp"
+#include "ecoro/timer_wheel.hpp"
+
+#include <cstdint>
+
+namespace ecoro::detail {
+
+// A unit of work queued on a scheduler. It lives inside the awaiter that
+// produced it, so queueing does not allocate.
+struct scheduler_operation {
+  using execute_fn = void(scheduler_operation *) noexcept;
+
+  explicit scheduler_operation(execute_fn *execute) noexcept
+      : execute_(execute) {}
+
+  void execute() noexcept {
+    execute_(this);
+  }
+
+  execute_fn *execute_;
+  scheduler_operation *next_{nullptr};
+};
+
+// Resumes the stored coroutine when executed.
+struct resume_operation : scheduler_operation {
+  resume_operation() noexcept
+      : scheduler_operation{&execute} {}
+
+  static void execute(scheduler_operation *that) noexcept {
+    static_cast<resume_operation *>(that)->continuation_.resume();
+  }
+
+  std::coroutine_handle<> continuation_;
+};
+
+// Resumes the stored coroutine once the deadline is reached, or right away
+// once cancelled. Schedulers change the state under the same guard as the
+// timers.
+struct timer_operation : timer_node, resume_operation {
+  enum class state : std::uint8_t { idle, added, cancelled };
+
+  bool cancelled() const noexcept {
+    return state_ == state::cancelled;
+  }
+
+  state state_{state::idle};
+};
+
+// Intrusive FIFO of operations, not thread-safe.
+class operation_queue {
+ public:
+  bool empty() const noexcept {
+    return head_ == nullptr;
+  }
+
+  void push_back(scheduler_operation *op) noexcept {
+    op->next_ = nullptr;
+    if (tail_) {
+      tail_->next_ = op;
+    } else {
+      head_ = op;
+    }
+    tail_ = op;
+  }
+
+  scheduler_operation *pop_front() noexcept {
+    auto *op = head_;
+    if (op) {
+      head_ = op->next_;
+      if (!head_) {
+        tail_ = nullptr;
+      }
+      op->next_ = nullptr;
+    }
+
+    return op;
+  }
+
+ private:
+  scheduler_operation *head_{nullptr};
+  scheduler_operation *tail_{nullptr};
+};
+
+}  // namespace ecoro::detail
+
+#endif  // ECORO_DETAIL_SCHEDULER_OPERATION_HPP
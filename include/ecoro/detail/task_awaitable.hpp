@@ -8,6 +8,7 @@
 
 #include "ecoro/coroutine.hpp"
 #include "ecoro/detail/traits.hpp"
+#include "ecoro/stop_token.hpp"
 
 namespace ecoro {
 
@@ -34,6 +35,35 @@ struct has_set_scheduler<
   using type = set_scheduler_expr<Promise>;
 };
 
+template<typename Promise>
+using stop_token_expr = decltype(std::declval<Promise>().stop_token());
+
+template<typename Promise>
+inline constexpr bool has_stop_token =
+    is_detected<stop_token_expr, Promise>::value;
+
+// Children run on the scheduler of the coroutine that awaits them.
+template<typename Promise>
+scheduler *awaiting_scheduler(
+    std::coroutine_handle<Promise> awaiting_coroutine) noexcept {
+  if constexpr (has_set_scheduler<Promise>::value) {
+    return awaiting_coroutine.promise().scheduler();
+  } else {
+    return nullptr;
+  }
+}
+
+// And they are cancelled together with it.
+template<typename Promise>
+ecoro::stop_token awaiting_stop_token(
+    std::coroutine_handle<Promise> awaiting_coroutine) noexcept {
+  if constexpr (has_stop_token<Promise>) {
+    return awaiting_coroutine.promise().stop_token();
+  } else {
+    return {};
+  }
+}
+
 template<typename Promise>
 struct task_awaitable {
   bool await_ready() const noexcept {
@@ -44,8 +74,7 @@ struct task_awaitable {
   template<typename P>
   auto await_suspend(std::coroutine_handle<P> awaiting_coro) noexcept {
     if constexpr (has_set_scheduler<P>::value) {
-      coroutine_handle_.promise().set_scheduler(
-          awaiting_coro.promise().scheduler());
+      inherit_scheduler(awaiting_coro.promise());
     }
 
     coroutine_handle_.promise().set_continuation(awaiting_coro);
@@ -72,14 +101,30 @@ struct task_awaitable {
     // as this will provide ability to suspend the awaiting coroutine and
     // resume another coroutine with a guaranteed tail-call to resume().
     if constexpr (has_set_scheduler<P>::value) {
-      coroutine_handle_.promise().set_scheduler(
-          awaiting_coro.promise().scheduler());
+      inherit_scheduler(awaiting_coro.promise());
     }
     coroutine_handle_.resume();
     return coroutine_handle_.promise().set_continuation(awaiting_coro);
   }
 #endif  // SYMMETRIC_TRANSFER
 
+  template<typename P>
+  void inherit_scheduler(P &awaiting_promise) noexcept {
+    // A scheduler set explicitly on the task wins over the awaiting one.
+    auto &promise = coroutine_handle_.promise();
+    if (!promise.scheduler()) {
+      promise.set_scheduler(awaiting_promise.scheduler());
+    }
+
+    if constexpr (has_stop_token<P> && has_stop_token<Promise>) {
+      // So does the stop token, copying an empty one costs nothing.
+      if (!promise.stop_token().stop_possible() &&
+          awaiting_promise.stop_token().stop_possible()) {
+        promise.set_stop_token(awaiting_promise.stop_token());
+      }
+    }
+  }
+
   decltype(auto) await_resume() {
     return coroutine_handle_.promise().result();
   }
@@ -87,6 +132,12 @@ struct task_awaitable {
   std::coroutine_handle<Promise> coroutine_handle_;
 };
 
+// Awaits a task without taking its result, the result stays in the task.
+template<typename Promise>
+struct task_ready_awaitable : task_awaitable<Promise> {
+  void await_resume() const noexcept {}
+};
+
 }  // namespace ecoro::detail
 
 #endif  // ECORO_DETAIL_TASK_AWAITABLE_HPP
@@ -48,6 +48,10 @@ class task_promise_impl {
     }
   }
 
+  bool has_exception() const noexcept {
+    return std::holds_alternative<std::exception_ptr>(result_variant_);
+  }
+
  private:
   using variant = std::variant<std::monostate, result_variant_value_type,
                                std::exception_ptr>;
@@ -71,6 +75,10 @@ class task_promise_impl<void> {
     exception_ = std::current_exception();
   }
 
+  bool has_exception() const noexcept {
+    return static_cast<bool>(exception_);
+  }
+
  private:
   std::exception_ptr exception_;
 };
@@ -0,0 +1,153 @@
+// Copyright 2022 - present, Mikhail Svetkin
+// All rights reserved.
+//
+// For the license information refer to LICENSE
+
+#ifndef ECORO_DETAIL_WORK_STEALING_DEQUE_HPP
+#define ECORO_DETAIL_WORK_STEALING_DEQUE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace ecoro::detail {
+
+// Chase-Lev work-stealing deque.
+//
+// The owner thread pushes and pops at the bottom, any other thread steals
+// from the top. Memory orderings follow "Correct and Efficient
+// Work-Stealing for Weak Memory Models" (Le, Pop, Cohen, Zappa Nardelli).
+template<typename T>
+class work_stealing_deque {
+  static_assert(std::is_pointer_v<T>, "T must be a pointer");
+
+  class ring {
+   public:
+    explicit ring(const std::int64_t capacity)
+        : mask_(capacity - 1),
+          items_(std::make_unique<std::atomic<T>[]>(capacity)) {}
+
+    std::int64_t capacity() const noexcept {
+      return mask_ + 1;
+    }
+
+    T load(const std::int64_t index) const noexcept {
+      return items_[index & mask_].load(std::memory_order_relaxed);
+    }
+
+    void store(const std::int64_t index, T item) noexcept {
+      items_[index & mask_].store(item, std::memory_order_relaxed);
+    }
+
+    std::unique_ptr<ring> grow(const std::int64_t top,
+                               const std::int64_t bottom) const {
+      auto bigger = std::make_unique<ring>(capacity() * 2);
+      for (auto i = top; i != bottom; ++i) {
+        bigger->store(i, load(i));
+      }
+
+      return bigger;
+    }
+
+   private:
+    std::int64_t mask_;
+    std::unique_ptr<std::atomic<T>[]> items_;
+  };
+
+ public:
+  explicit work_stealing_deque(const std::int64_t capacity = 256)
+      : ring_(new ring(capacity)) {
+    rings_.emplace_back(ring_.load(std::memory_order_relaxed));
+  }
+
+  work_stealing_deque(const work_stealing_deque &) = delete;
+  work_stealing_deque &operator=(const work_stealing_deque &) = delete;
+
+  bool empty() const noexcept {
+    const auto bottom = bottom_.load(std::memory_order_relaxed);
+    const auto top = top_.load(std::memory_order_relaxed);
+    return bottom <= top;
+  }
+
+  std::size_t size() const noexcept {
+    const auto bottom = bottom_.load(std::memory_order_relaxed);
+    const auto top = top_.load(std::memory_order_relaxed);
+    return bottom > top ? static_cast<std::size_t>(bottom - top) : 0;
+  }
+
+  // Owner only.
+  void push(T item) {
+    const auto bottom = bottom_.load(std::memory_order_relaxed);
+    const auto top = top_.load(std::memory_order_acquire);
+    auto *current = ring_.load(std::memory_order_relaxed);
+
+    if (bottom - top > current->capacity() - 1) {
+      // Old rings are kept alive until destruction, a thief might still be
+      // reading from them.
+      current = rings_.emplace_back(current->grow(top, bottom)).get();
+      ring_.store(current, std::memory_order_release);
+    }
+
+    current->store(bottom, item);
+    bottom_.store(bottom + 1, std::memory_order_release);
+  }
+
+  // Owner only.
+  T pop() noexcept {
+    const auto bottom = bottom_.load(std::memory_order_relaxed) - 1;
+    auto *current = ring_.load(std::memory_order_relaxed);
+    bottom_.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto top = top_.load(std::memory_order_relaxed);
+
+    if (top > bottom) {
+      bottom_.store(bottom + 1, std::memory_order_relaxed);
+      return nullptr;
+    }
+
+    T item = current->load(bottom);
+    if (top == bottom) {
+      // The last item, race against thieves.
+      if (!top_.compare_exchange_strong(top, top + 1,
+                                        std::memory_order_seq_cst,
+                                        std::memory_order_relaxed)) {
+        item = nullptr;
+      }
+      bottom_.store(bottom + 1, std::memory_order_relaxed);
+    }
+
+    return item;
+  }
+
+  // Any thread.
+  T steal() noexcept {
+    auto top = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const auto bottom = bottom_.load(std::memory_order_acquire);
+
+    if (top >= bottom) {
+      return nullptr;
+    }
+
+    T item = ring_.load(std::memory_order_acquire)->load(top);
+    if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                      std::memory_order_relaxed)) {
+      return nullptr;
+    }
+
+    return item;
+  }
+
+ private:
+  alignas(64) std::atomic<std::int64_t> top_{0};
+  alignas(64) std::atomic<std::int64_t> bottom_{0};
+  std::atomic<ring *> ring_;
+  std::vector<std::unique_ptr<ring>> rings_;
+};
+
+}  // namespace ecoro::detail
+
+#endif  // ECORO_DETAIL_WORK_STEALING_DEQUE_HPP
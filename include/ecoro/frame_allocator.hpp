@@ -0,0 +1,187 @@
+// Copyright 2022 - present, Mikhail Svetkin
+// All rights reserved.
+//
+// For the license information refer to LICENSE
+
+#ifndef ECORO_FRAME_ALLOCATOR_HPP
+#define ECORO_FRAME_ALLOCATOR_HPP
+
+#include <cstddef>
+#include <memory>
+#include <new>
+
+namespace ecoro {
+
+// Allocates coroutine frames with the global operator new.
+struct heap_frame_allocator {
+  static void *allocate(const std::size_t size) {
+    return ::operator new(size);
+  }
+
+  static void deallocate(void *ptr, const std::size_t size) noexcept {
+    ::operator delete(ptr, size);
+  }
+};
+
+// Keeps freed frames in thread-local free lists segregated by size class, so
+// short-lived coroutines reuse frames instead of calling malloc/free.
+//
+// A frame may be freed on another thread than the one it was allocated on,
+// it then goes to the free list of that thread. Every list holds a limited
+// number of frames, the rest goes back to the heap. Frames larger than
+// max_size are not pooled.
+struct pooled_frame_allocator {
+  static constexpr std::size_t granularity = 64;
+  static constexpr std::size_t max_size = 2048;
+  static constexpr std::size_t max_cached = 64;
+
+  static void *allocate(std::size_t size);
+  static void deallocate(void *ptr, std::size_t size) noexcept;
+};
+
+#if defined(ECORO_FRAME_ALLOCATOR)
+using default_frame_allocator = ECORO_FRAME_ALLOCATOR;
+#else
+using default_frame_allocator = pooled_frame_allocator;
+#endif
+
+namespace detail {
+
+// Every frame ends with the function that frees it, followed by the
+// allocator passed with std::allocator_arg if there was one. That lets
+// operator delete release frames from different allocators.
+using frame_deallocate_fn = void(void *frame, std::size_t size) noexcept;
+
+constexpr std::size_t align_frame_up(const std::size_t size,
+                                     const std::size_t alignment) noexcept {
+  return (size + alignment - 1) & ~(alignment - 1);
+}
+
+constexpr std::size_t frame_deallocate_offset(const std::size_t size) noexcept {
+  return align_frame_up(size, alignof(frame_deallocate_fn *));
+}
+
+constexpr std::size_t frame_size(const std::size_t size) noexcept {
+  return frame_deallocate_offset(size) + sizeof(frame_deallocate_fn *);
+}
+
+template<typename Alloc>
+constexpr std::size_t frame_allocator_offset(const std::size_t size) noexcept {
+  return align_frame_up(frame_size(size), alignof(Alloc));
+}
+
+inline void set_frame_deallocate(void *frame, const std::size_t size,
+                                 frame_deallocate_fn *deallocate) noexcept {
+  ::new (static_cast<std::byte *>(frame) + frame_deallocate_offset(size))
+      frame_deallocate_fn *(deallocate);
+}
+
+inline frame_deallocate_fn *get_frame_deallocate(
+    void *frame, const std::size_t size) noexcept {
+  return *std::launder(reinterpret_cast<frame_deallocate_fn **>(
+      static_cast<std::byte *>(frame) + frame_deallocate_offset(size)));
+}
+
+template<typename Allocator>
+void deallocate_frame(void *frame, const std::size_t size) noexcept {
+  Allocator::deallocate(frame, frame_size(size));
+}
+
+// Allocates frames with a standard allocator passed as a coroutine argument.
+template<typename Alloc>
+struct frame_allocator_arg {
+  static_assert(alignof(Alloc) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__,
+                "over-aligned frame allocators are not supported");
+
+  struct alignas(__STDCPP_DEFAULT_NEW_ALIGNMENT__) block {
+    std::byte data[__STDCPP_DEFAULT_NEW_ALIGNMENT__];
+  };
+
+  using block_allocator =
+      typename std::allocator_traits<Alloc>::template rebind_alloc<block>;
+  using block_traits = std::allocator_traits<block_allocator>;
+
+  static std::size_t block_count(const std::size_t size) noexcept {
+    return (frame_allocator_offset<Alloc>(size) + sizeof(Alloc) +
+            sizeof(block) - 1) /
+           sizeof(block);
+  }
+
+  static Alloc *allocator(void *frame, const std::size_t size) noexcept {
+    return std::launder(reinterpret_cast<Alloc *>(
+        static_cast<std::byte *>(frame) + frame_allocator_offset<Alloc>(size)));
+  }
+
+  static void *allocate(const Alloc &alloc, const std::size_t size) {
+    block_allocator blocks{alloc};
+    void *frame = block_traits::allocate(blocks, block_count(size));
+    ::new (static_cast<void *>(allocator(frame, size))) Alloc(alloc);
+    set_frame_deallocate(frame, size, &deallocate);
+    return frame;
+  }
+
+  static void deallocate(void *frame, const std::size_t size) noexcept {
+    auto *stored = allocator(frame, size);
+    block_allocator blocks{std::move(*stored)};
+    stored->~Alloc();
+    block_traits::deallocate(blocks, static_cast<block *>(frame),
+                             block_count(size));
+  }
+};
+
+}  // namespace detail
+
+// Makes the promise allocate its coroutine frame with Allocator.
+//
+// A coroutine whose parameters start with std::allocator_arg and an
+// allocator, either right away or after the object parameter of a member
+// function, gets its frame from that allocator instead:
+//
+//   task<int> f(std::allocator_arg_t, arena_allocator<std::byte> alloc);
+template<typename Allocator = default_frame_allocator>
+struct frame_allocated {
+  static void *operator new(const std::size_t size) {
+    void *frame = Allocator::allocate(detail::frame_size(size));
+    detail::set_frame_deallocate(frame, size,
+                                 &detail::deallocate_frame<Allocator>);
+    return frame;
+  }
+
+  template<typename Alloc, typename... Args>
+  static void *operator new(const std::size_t size, std::allocator_arg_t,
+                            const Alloc &alloc, const Args &...) {
+    return detail::frame_allocator_arg<Alloc>::allocate(alloc, size);
+  }
+
+  template<typename This, typename Alloc, typename... Args>
+  static void *operator new(const std::size_t size, const This &,
+                            std::allocator_arg_t, const Alloc &alloc,
+                            const Args &...) {
+    return detail::frame_allocator_arg<Alloc>::allocate(alloc, size);
+  }
+
+  static void operator delete(void *ptr, const std::size_t size) noexcept {
+    detail::get_frame_deallocate(ptr, size)(ptr, size);
+  }
+
+  // Pair the allocator_arg forms of operator new. Coroutine frames are
+  // released through the usual form above, both end up in the function
+  // stored in the frame.
+  template<typename Alloc, typename... Args>
+  static void operator delete(void *ptr, const std::size_t size,
+                              std::allocator_arg_t, const Alloc &,
+                              const Args &...) noexcept {
+    detail::get_frame_deallocate(ptr, size)(ptr, size);
+  }
+
+  template<typename This, typename Alloc, typename... Args>
+  static void operator delete(void *ptr, const std::size_t size, const This &,
+                              std::allocator_arg_t, const Alloc &,
+                              const Args &...) noexcept {
+    detail::get_frame_deallocate(ptr, size)(ptr, size);
+  }
+};
+
+}  // namespace ecoro
+
+#endif  // ECORO_FRAME_ALLOCATOR_HPP
@@ -0,0 +1,116 @@
+// Copyright 2022 - present, Mikhail Svetkin
+// All rights reserved.
+//
+// For the license information refer to LICENSE
+
+#ifndef ECORO_HEDGE_HPP
+#define ECORO_HEDGE_HPP
+
+#include "ecoro/task.hpp"
+#include "ecoro/stop_token.hpp"
+#include "ecoro/this_coro.hpp"
+#include "ecoro/until_stopped.hpp"
+#include "ecoro/when_any.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace ecoro {
+
+namespace detail {
+
+template<typename Factory>
+using hedge_result_type =
+    typename std::invoke_result_t<Factory &>::value_type;
+
+// Shared by the attempts, a lost attempt may still run after hedge has
+// returned.
+template<typename Factory>
+struct hedge_state {
+  hedge_state(Factory &&factory, const std::size_t attempts)
+      : factory(std::move(factory)), attempts(attempts) {}
+
+  Factory factory;
+  const std::size_t attempts;
+  std::atomic<std::size_t> failures{0};
+};
+
+// Waits for its turn and starts one attempt. The wait is a cancellable
+// timer, so an attempt that is not needed anymore never starts. A failed
+// attempt stays out of the race until it is decided, unless it is the last
+// one to fail.
+template<typename Factory>
+task<hedge_result_type<Factory>> hedge_attempt(
+    const std::shared_ptr<hedge_state<Factory>> state,
+    const std::chrono::steady_clock::duration delay) {
+  if (delay > std::chrono::steady_clock::duration::zero()) {
+    co_await this_coro::sleep_for(delay);
+  }
+
+  std::exception_ptr failure;
+  try {
+    co_return co_await std::invoke(state->factory);
+  } catch (...) {
+    failure = std::current_exception();
+  }
+
+  if (state->failures.fetch_add(1, std::memory_order_acq_rel) + 1 <
+      state->attempts) {
+    co_await until_stopped(co_await this_coro::stop_token());
+    throw operation_cancelled{};
+  }
+
+  std::rethrow_exception(failure);
+}
+
+}  // namespace detail
+
+// Starts factory() and, every `delay` the previous attempts have not
+// finished, one more attempt, up to max_attempts in total. The first
+// successful attempt wins, the others are cancelled through their stop
+// token and finish in the background, as in when_any. If every attempt
+// fails, the last failure is rethrown.
+//
+// The attempts are timed by the scheduler of the awaiting coroutine, without
+// one only a single attempt is made.
+template<typename Factory, typename Rep, typename Period>
+[[nodiscard]] task<detail::hedge_result_type<Factory>> hedge(
+    Factory factory, const std::chrono::duration<Rep, Period> delay,
+    const std::size_t max_attempts) {
+  using clock = std::chrono::steady_clock;
+
+  if (max_attempts == 0) {
+    throw std::invalid_argument{"hedge needs at least one attempt"};
+  }
+
+  if (max_attempts == 1 || !co_await this_coro::scheduler()) {
+    co_return co_await std::invoke(factory);
+  }
+
+  const auto step = std::chrono::ceil<clock::duration>(delay);
+  const auto state = std::make_shared<detail::hedge_state<Factory>>(
+      std::move(factory), max_attempts);
+
+  std::vector<task<detail::hedge_result_type<Factory>>> attempts;
+  attempts.reserve(max_attempts);
+  for (std::size_t i = 0; i < max_attempts; ++i) {
+    attempts.push_back(detail::hedge_attempt(
+        state, step * static_cast<clock::duration::rep>(i)));
+  }
+
+  auto winner = co_await when_any(std::move(attempts));
+  if constexpr (!std::is_void_v<detail::hedge_result_type<Factory>>) {
+    co_return std::move(winner.value);
+  }
+}
+
+}  // namespace ecoro
+
+#endif  // ECORO_HEDGE_HPP
@@ -0,0 +1,127 @@
+// Copyright 2022 - present, Mikhail Svetkin
+// All rights reserved.
+//
+// For the license information refer to LICENSE
+
+#ifndef ECORO_INPLACE_STOP_TOKEN_HPP
+#define ECORO_INPLACE_STOP_TOKEN_HPP
+
+#include "ecoro/stop_token.hpp"
+
+#include <type_traits>
+
+namespace ecoro {
+
+class inplace_stop_source;
+
+// Non-owning counterpart of stop_token: a pointer to the state that lives
+// inside an inplace_stop_source. The source has to outlive the tokens and
+// callbacks, which structured concurrency gives for free.
+class inplace_stop_token {
+ public:
+  inplace_stop_token() noexcept = default;
+
+  [[nodiscard]] bool stop_requested() const noexcept {
+    return state_ && state_->stop_requested();
+  }
+
+  [[nodiscard]] bool stop_possible() const noexcept {
+    return state_ != nullptr;
+  }
+
+  friend bool operator==(const inplace_stop_token &,
+                         const inplace_stop_token &) noexcept = default;
+
+ private:
+  friend class inplace_stop_source;
+
+  template<typename Callback>
+  friend class inplace_stop_callback;
+
+  explicit inplace_stop_token(detail::_st::stop_state *state) noexcept
+      : state_(state) {}
+
+  detail::_st::stop_state *state_{nullptr};
+};
+
+// Keeps the stop state in place, neither allocates nor counts references.
+// Not movable, the tokens point into it.
+class inplace_stop_source {
+ public:
+  inplace_stop_source() noexcept = default;
+
+  inplace_stop_source(const inplace_stop_source &) = delete;
+  inplace_stop_source &operator=(const inplace_stop_source &) = delete;
+
+  [[nodiscard]] inplace_stop_token get_token() const noexcept {
+    return inplace_stop_token{&state_};
+  }
+
+  void request_stop() noexcept {
+    state_.request_stop();
+  }
+
+  [[nodiscard]] bool stop_requested() const noexcept {
+    return state_.stop_requested();
+  }
+
+ private:
+  mutable detail::_st::stop_state state_;
+};
+
+template<typename Callback>
+class [[nodiscard]] inplace_stop_callback {
+  static_assert(std::is_nothrow_destructible_v<Callback>);
+  static_assert(invocable<Callback>);
+
+ public:
+  using callback_type = Callback;
+
+  template<typename OtherCallback>
+      requires invocable<OtherCallback> &&
+               constructible_from<Callback, OtherCallback>
+  explicit inplace_stop_callback(
+      const inplace_stop_token token, OtherCallback &&callback) noexcept(
+      std::is_nothrow_constructible_v<Callback, OtherCallback>)
+      : model_(std::forward<OtherCallback>(callback)) {
+    if (token.state_ && token.state_->try_add_callback(model_)) {
+      state_ = token.state_;
+    }
+  }
+
+  ~inplace_stop_callback() {
+    if (state_) {
+      state_->remove_callback(model_);
+    }
+  }
+
+  inplace_stop_callback(const inplace_stop_callback &) = delete;
+  inplace_stop_callback &operator=(const inplace_stop_callback &) = delete;
+  inplace_stop_callback(inplace_stop_callback &&) = delete;
+  inplace_stop_callback &operator=(inplace_stop_callback &&) = delete;
+
+ private:
+  struct model : detail::_st::stop_callback_base {
+    template<typename OtherCallback>
+    explicit model(OtherCallback &&callback) noexcept
+        : detail::_st::stop_callback_base{&execute},
+          callback_(std::forward<OtherCallback>(callback)) {}
+
+    callback_type callback_;
+
+    static void execute(detail::_st::stop_callback_base *that) noexcept {
+      static_cast<model *>(that)->callback_();
+    }
+  };
+
+  model model_;
+  detail::_st::stop_state *state_{nullptr};
+};
+
+template<typename Callback>
+inplace_stop_callback(inplace_stop_token, Callback)
+    -> inplace_stop_callback<Callback>;
+
+}  // namespace ecoro
+
+#endif  // ECORO_INPLACE_STOP_TOKEN_HPP
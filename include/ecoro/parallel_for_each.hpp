@@ -0,0 +1,129 @@
+// Copyright 2022 - present, Mikhail Svetkin
+// All rights reserved.
+//
+// For the license information refer to LICENSE
+
+#ifndef ECORO_PARALLEL_FOR_EACH_HPP
+#define ECORO_PARALLEL_FOR_EACH_HPP
+
+#include "ecoro/task.hpp"
+#include "ecoro/when_all.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <ranges>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace ecoro {
+
+namespace detail {
+
+// Hands out the range elements one by one to the workers, which may run on
+// different threads. The first failure is kept and stops handing them out.
+template<typename Range>
+class parallel_for_each_source {
+  using iterator = std::ranges::iterator_t<Range>;
+
+ public:
+  explicit parallel_for_each_source(Range &range)
+      : next_(std::ranges::begin(range)),
+        end_(std::ranges::end(range)) {}
+
+  bool next(iterator &it) {
+    std::lock_guard lock{mutex_};
+    if (next_ == end_ || failure_) {
+      return false;
+    }
+
+    it = next_++;
+    return true;
+  }
+
+  void fail(std::exception_ptr failure) {
+    std::lock_guard lock{mutex_};
+    if (!failure_) {
+      failure_ = std::move(failure);
+    }
+  }
+
+  // Once every worker has finished.
+  void rethrow_if_failed() const {
+    if (failure_) {
+      std::rethrow_exception(failure_);
+    }
+  }
+
+ private:
+  std::mutex mutex_;
+  iterator next_;
+  std::ranges::sentinel_t<Range> end_;
+  std::exception_ptr failure_;
+};
+
+template<typename Range, typename Fn>
+task<void> parallel_for_each_worker(parallel_for_each_source<Range> &source,
+                                    Fn &fn) {
+  std::ranges::iterator_t<Range> it;
+  while (source.next(it)) {
+    try {
+      co_await std::invoke(fn, *it);
+    } catch (...) {
+      source.fail(std::current_exception());
+    }
+  }
+}
+
+// The view lives in the frame, so a range passed as an rvalue is owned by
+// the task.
+template<std::ranges::view View, typename Fn>
+task<void> parallel_for_each(View range, const std::size_t max_in_flight,
+                             Fn fn) {
+  parallel_for_each_source<View> source{range};
+
+  auto worker_count = max_in_flight;
+  if constexpr (std::ranges::sized_range<View>) {
+    worker_count = std::min(worker_count,
+                            static_cast<std::size_t>(std::ranges::size(range)));
+  }
+
+  std::vector<task<void>> workers;
+  workers.reserve(worker_count);
+  for (std::size_t i = 0; i < worker_count; ++i) {
+    workers.push_back(parallel_for_each_worker(source, fn));
+  }
+
+  co_await when_all(std::move(workers));
+  source.rethrow_if_failed();
+}
+
+}  // namespace detail
+
+// Awaits fn(element) for every element of the range with at most
+// max_in_flight of them running at once. A new one starts as soon as a
+// running one finishes, so only max_in_flight frames exist at a time.
+//
+// Once an element fails no new ones are started, the first exception to be
+// thrown is rethrown after the running ones finish. An lvalue range has to outlive
+// the returned task, an rvalue one is moved into it. Elements are handed
+// out to the workers by iterator, so the range has to be a forward range.
+template<std::ranges::forward_range Range, typename Fn>
+  requires std::ranges::viewable_range<Range>
+[[nodiscard]] task<void> parallel_for_each(Range &&range,
+                                           const std::size_t max_in_flight,
+                                           Fn fn) {
+  if (max_in_flight == 0) {
+    throw std::invalid_argument{"parallel_for_each needs max_in_flight > 0"};
+  }
+
+  return detail::parallel_for_each(std::views::all(std::forward<Range>(range)),
+                                   max_in_flight, std::move(fn));
+}
+
+}  // namespace ecoro
+
+#endif  // ECORO_PARALLEL_FOR_EACH_HPP
@@ -6,18 +6,164 @@
 #ifndef ECORO_SCHEDULER_HPP
 #define ECORO_SCHEDULER_HPP
 
-#include "ecoro/task.hpp"
+#include "ecoro/coroutine.hpp"
+#include "ecoro/detail/scheduler_operation.hpp"
+#include "ecoro/detail/task_awaitable.hpp"
+#include "ecoro/stop_token.hpp"
 
 #include <chrono>
+#include <optional>
 
 namespace ecoro {
 
+class scheduler;
+
+namespace detail {
+
+struct cancel_timer_callback {
+  void operator()() const noexcept;
+
+  scheduler *scheduler_;
+  timer_operation *operation_;
+};
+
+// Adds the timer and cancels it once a stop is requested on the token of
+// the awaiting coroutine. A cancelled wait resumes right away and its
+// awaiter throws operation_cancelled, so the coroutine unwinds and its
+// owner can join it.
+class cancellable_timer {
+ public:
+  template<typename Promise>
+  void start(scheduler &scheduler, timer_operation &operation,
+             std::coroutine_handle<Promise> awaiting_coroutine) noexcept;
+
+ private:
+  std::optional<stop_callback<cancel_timer_callback>> on_stop_;
+};
+
+}  // namespace detail
+
+// Base class of all schedulers.
+//
+// schedule() and schedule_after() return awaiters that keep the queued
+// operation inside the awaiting coroutine frame, so neither of them
+// allocates. Schedulers only have to implement enqueue() and add_timer().
 class scheduler {
  public:
-  [[nodiscard]] virtual task<void> schedule_after(
-      const std::chrono::nanoseconds delay) noexcept = 0;
+  class schedule_awaiter {
+   public:
+    explicit schedule_awaiter(scheduler &scheduler) noexcept
+        : scheduler_(scheduler) {}
+
+    bool await_ready() const noexcept {
+      return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> awaiting_coroutine) noexcept {
+      operation_.continuation_ = awaiting_coroutine;
+      scheduler_.enqueue(&operation_);
+    }
+
+    void await_resume() const noexcept {}
+
+   private:
+    scheduler &scheduler_;
+    detail::resume_operation operation_;
+  };
+
+  class timer_awaiter {
+   public:
+    timer_awaiter(scheduler &scheduler,
+                  std::chrono::steady_clock::time_point deadline) noexcept
+        : scheduler_(scheduler) {
+      operation_.deadline = deadline;
+    }
+
+    bool await_ready() const noexcept {
+      return false;
+    }
+
+    template<typename Promise>
+    void await_suspend(
+        std::coroutine_handle<Promise> awaiting_coroutine) noexcept {
+      operation_.continuation_ = awaiting_coroutine;
+      timer_.start(scheduler_, operation_, awaiting_coroutine);
+    }
+
+    void await_resume() const {
+      if (operation_.cancelled()) {
+        throw operation_cancelled{};
+      }
+    }
+
+   private:
+    scheduler &scheduler_;
+    detail::timer_operation operation_;
+    detail::cancellable_timer timer_;
+  };
+
+  [[nodiscard]] schedule_awaiter schedule() noexcept {
+    return schedule_awaiter{*this};
+  }
+
+  [[nodiscard]] timer_awaiter schedule_at(
+      const std::chrono::steady_clock::time_point deadline) noexcept {
+    return timer_awaiter{*this, deadline};
+  }
+
+  [[nodiscard]] timer_awaiter schedule_after(
+      const std::chrono::nanoseconds delay) noexcept {
+    return schedule_at(std::chrono::steady_clock::now() + delay);
+  }
+
+  // Runs the operation on the scheduler.
+  virtual void enqueue(detail::scheduler_operation *operation) noexcept = 0;
+
+  // Same as enqueue(), but the operation runs after the work that is already
+  // queued, so a yielding coroutine lets others make progress.
+  virtual void yield(detail::scheduler_operation *operation) noexcept {
+    enqueue(operation);
+  }
+
+  // Runs the operation on the scheduler once its deadline is reached.
+  virtual void add_timer(detail::timer_operation &operation) noexcept = 0;
+
+  // Removes a pending timer and marks it cancelled, the caller then
+  // enqueues it. A timer that has not been added yet is marked too and runs
+  // as soon as it is added. Returns false if nothing was removed, that is
+  // the timer has already expired or has not been added yet.
+  virtual bool cancel_timer(detail::timer_operation &operation) noexcept = 0;
+
+ protected:
+  ~scheduler() = default;
 };
 
+namespace detail {
+
+inline void cancel_timer_callback::operator()() const noexcept {
+  if (scheduler_->cancel_timer(*operation_)) {
+    scheduler_->enqueue(operation_);
+  }
+}
+
+template<typename Promise>
+void cancellable_timer::start(
+    scheduler &scheduler, timer_operation &operation,
+    std::coroutine_handle<Promise> awaiting_coroutine) noexcept {
+  if constexpr (has_stop_token<Promise>) {
+    const auto &token = awaiting_coroutine.promise().stop_token();
+    if (token.stop_possible()) {
+      // Registered before the timer is added: once added, the timer may
+      // fire and resume the coroutine on another thread.
+      on_stop_.emplace(token, cancel_timer_callback{&scheduler, &operation});
+    }
+  }
+
+  scheduler.add_timer(operation);
+}
+
+}  // namespace detail
+
 }  // namespace ecoro
 
 #endif  // ECORO_SCHEDULER_HPP
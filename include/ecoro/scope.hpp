@@ -8,6 +8,7 @@
 
 #include "ecoro/coroutine.hpp"
 #include "ecoro/detail/invoke_or_pass.hpp"
+#include "ecoro/frame_allocator.hpp"
 #include "ecoro/scope_guard.hpp"
 
 #include <atomic>
@@ -37,18 +38,20 @@ class scope {
       }
 
       bool await_suspend(std::coroutine_handle<> continuation) noexcept {
-        if (scope_.size()) {
-          scope_.continuation_ = continuation;
-          return false;
-        }
-
-        return true;
+        joined_ = true;
+        scope_.continuation_ = continuation;
+        return scope_.try_join();
       }
 
-      void await_resume() noexcept {}
+      void await_resume() noexcept {
+        if (joined_) {
+          scope_.on_joined();
+        }
+      }
 
      private:
       scope &scope_;
+      bool joined_{false};
     };
 
     return join_awaiter{*this};
@@ -58,7 +61,7 @@ class scope {
 
  private:
   struct oneway_task {
-    struct promise_type {
+    struct promise_type : frame_allocated<> {
       std::suspend_never initial_suspend() const noexcept {
         return {};
       }
@@ -83,15 +86,20 @@ class scope {
   oneway_task run(Awaitable awaitable) {
     on_task_started();
     awaitable.set_scheduler(scheduler_);
-    auto on_completion = scope_guard(this, &scope::on_task_finished);
+    auto on_completion = basic_scope_guard{[this] { on_task_finished(); }};
     co_await std::move(awaitable);
   }
 
   void on_task_started();
   void on_task_finished();
+  bool try_join() noexcept;
+  void on_joined() noexcept;
 
  private:
-  std::atomic<std::size_t> count_{0u};
+  // Every running task adds two, the lowest bit is set until the scope is
+  // joined. That lets the last finished task and join() agree on who resumes
+  // the continuation.
+  std::atomic<std::size_t> count_{1u};
   std::coroutine_handle<> continuation_;
   scheduler *scheduler_{nullptr};
 };
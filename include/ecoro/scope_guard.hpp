@@ -8,10 +8,34 @@
 
 #include <functional>
 #include <memory>
+#include <optional>
+#include <type_traits>
 #include <utility>
 
 namespace ecoro {
 
+namespace detail {
+
+template<typename Context, typename Member>
+class member_callback {
+ public:
+  member_callback(Context *context, Member member) noexcept
+      : context_(context), member_(member) {}
+
+  void operator()() const {
+    (context_->*member_)();
+  }
+
+ private:
+  Context *context_;
+  Member member_;
+};
+
+}  // namespace detail
+
+// Calls the callback when it goes out of scope. The callback is type
+// erased, so guards with different callbacks share one type. Prefer
+// basic_scope_guard where the callback type is known, it never allocates.
 class scope_guard {
  public:
   template<typename Callable>
@@ -46,6 +70,59 @@ class scope_guard {
   std::function<void()> callback_;
 };
 
+// Same as scope_guard, but the callback is stored by value, so a guard
+// costs no more than the callback itself.
+template<typename Callback>
+class basic_scope_guard {
+ public:
+  explicit basic_scope_guard(Callback callback) noexcept(
+      std::is_nothrow_move_constructible_v<Callback>)
+      : callback_(std::move(callback)) {}
+
+  template<typename Context, typename Member>
+  explicit basic_scope_guard(Context *context, Member member) noexcept
+      : callback_(std::in_place, context, member) {}
+
+  basic_scope_guard(basic_scope_guard &&other) noexcept(
+      std::is_nothrow_move_constructible_v<Callback>)
+      : callback_(std::exchange(other.callback_, std::nullopt)) {}
+
+  // Takes over the callback of the other guard, the one it replaces is
+  // dropped without a call. Works for callbacks that can not be assigned,
+  // such as lambdas.
+  basic_scope_guard &operator=(basic_scope_guard &&other) noexcept(
+      std::is_nothrow_move_constructible_v<Callback>) {
+    if (std::addressof(other) != this) {
+      callback_.reset();
+      if (other.callback_) {
+        callback_.emplace(std::move(*other.callback_));
+        other.callback_.reset();
+      }
+    }
+
+    return *this;
+  }
+
+  ~basic_scope_guard() {
+    if (callback_) {
+      (*callback_)();
+    }
+  }
+
+  basic_scope_guard(const basic_scope_guard &) = delete;
+  basic_scope_guard &operator=(const basic_scope_guard &) = delete;
+
+ private:
+  std::optional<Callback> callback_;
+};
+
+template<typename Callback>
+basic_scope_guard(Callback) -> basic_scope_guard<Callback>;
+
+template<typename Context, typename Member>
+basic_scope_guard(Context *, Member)
+    -> basic_scope_guard<detail::member_callback<Context, Member>>;
+
 }  // namespace ecoro
 
 #endif  // ECORO_SCOPE_GUARD_HPP_
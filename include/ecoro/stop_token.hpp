@@ -9,14 +9,32 @@
 #include "ecoro/detail/std_concepts.hpp"
 #include "ecoro/detail/intrusive/list.hpp"
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <exception>
 #include <memory>
-#include <mutex>
+#include <optional>
+#include <thread>
 #include <type_traits>
 
 namespace ecoro {
 
+class scheduler;
+class stop_source;
+
+// Thrown from a wait that was cancelled by a stop request.
+class operation_cancelled : public std::exception {
+ public:
+  const char *what() const noexcept override {
+    return "operation cancelled";
+  }
+};
+
 namespace detail::_st {
 
+struct deadline_timer;
+
 struct stop_callback_base : intrusive::list_node<stop_callback_base> {
   using execute_fn = void(stop_callback_base*) noexcept;
 
@@ -26,20 +44,74 @@ struct stop_callback_base : intrusive::list_node<stop_callback_base> {
   void execute() noexcept;
 
   execute_fn *execute_;
+  // Set by request_stop() while the callback runs, so that a callback that
+  // destroys its own stop_callback can tell.
+  bool *destroyed_{nullptr};
+  std::atomic<bool> executed_{false};
 };
 
-class stop_state {
+// The stop flag and a lock bit share one atomic word, the lock only guards
+// the callback list and is never held while a callback runs. Registering
+// and deregistering therefore cost a compare-and-swap each, the same as in
+// libstdc++ std::stop_token.
+//
+// A state may be linked to a parent: it is then one more callback in the
+// parent's list, so linking and unlinking are O(1) and a stop of the parent
+// reaches the whole tree. The link is added by stop_source once the state
+// is owned by a shared_ptr, a parent stopped on another thread may run it
+// right away.
+//
+// A deadline is a timer of a scheduler that requests the stop when it
+// fires. Linked states also fire with their parent, so the effective
+// deadline is the tightest one on the way to the root.
+class stop_state : public std::enable_shared_from_this<stop_state> {
  public:
+  stop_state() noexcept = default;
+  ~stop_state();
+
+  stop_state(const stop_state &) = delete;
+  stop_state &operator=(const stop_state &) = delete;
+
   void request_stop() noexcept;
   [[nodiscard]] bool stop_requested() const noexcept;
 
   bool try_add_callback(stop_callback_base &callback) noexcept;
   void remove_callback(stop_callback_base &callback) noexcept;
 
+  void request_stop_at(scheduler &scheduler,
+                       std::chrono::steady_clock::time_point deadline);
+  [[nodiscard]] std::optional<std::chrono::steady_clock::time_point> deadline()
+      const noexcept;
+
  private:
-  bool stop_requested_{false};
+  friend struct deadline_timer;
+  friend class ecoro::stop_source;
+
+  struct parent_link : stop_callback_base {
+    explicit parent_link(stop_state &state) noexcept
+        : stop_callback_base{&execute},
+          state_(&state) {}
+
+    static void execute(stop_callback_base *that) noexcept;
+
+    stop_state *state_;
+  };
+
+  static constexpr std::uint32_t stop_requested_bit = 1;
+  static constexpr std::uint32_t locked_bit = 2;
+
+  void lock() noexcept;
+  bool try_lock(std::uint32_t mask_bits, std::uint32_t new_bits) noexcept;
+  void unlock() noexcept;
+
+  std::atomic<std::uint32_t> value_{0};
   intrusive::list<stop_callback_base> callbacks_;
-  std::mutex mutex_;
+  std::thread::id requester_;
+  std::atomic<std::chrono::steady_clock::rep> deadline_{
+    std::chrono::steady_clock::duration::max().count()};
+  deadline_timer *timer_{nullptr};
+  parent_link parent_link_{*this};
+  std::shared_ptr<stop_state> parent_;
 };
 
 }  // namespace detail::_st
@@ -58,10 +130,17 @@ class stop_token {
   [[nodiscard]] bool stop_requested() const noexcept;
   [[nodiscard]] bool stop_possible() const noexcept;
 
+  // When the stop is requested at the latest, if a deadline was set on the
+  // source or on one of the sources it is linked to.
+  [[nodiscard]] std::optional<std::chrono::steady_clock::time_point> deadline()
+      const noexcept;
+
  private:
   template<typename Callback>
   friend class stop_callback;
 
+  friend class stop_source;
+
   std::weak_ptr<detail::_st::stop_state> state_;
 };
 
@@ -75,6 +154,9 @@ class stop_source {
  public:
   stop_source();
   explicit stop_source(nostopstate_t nss) noexcept;
+  // Stops when the parent does, a stop of its own does not reach the
+  // parent. Without a parent stop state it is an ordinary source.
+  explicit stop_source(const stop_token &parent);
 
   stop_source(const stop_source &other) noexcept = default;
   stop_source(stop_source &&other) noexcept = default;
@@ -86,6 +168,23 @@ class stop_source {
   void request_stop() noexcept;
   [[nodiscard]] bool stop_requested() const noexcept;
 
+  // Requests the stop once the deadline is reached on the scheduler, which
+  // has to outlive the source. A later deadline than the one already set
+  // is ignored.
+  void request_stop_at(scheduler &scheduler,
+                       std::chrono::steady_clock::time_point deadline);
+
+  template<typename Rep, typename Period>
+  void request_stop_after(scheduler &scheduler,
+                          const std::chrono::duration<Rep, Period> delay) {
+    using clock = std::chrono::steady_clock;
+    request_stop_at(scheduler,
+                    clock::now() + std::chrono::ceil<clock::duration>(delay));
+  }
+
+  [[nodiscard]] std::optional<std::chrono::steady_clock::time_point> deadline()
+      const noexcept;
+
  private:
   std::shared_ptr<detail::_st::stop_state> state_;
 };
@@ -9,6 +9,8 @@
 #include "ecoro/detail/task_awaitable.hpp"
 #include "ecoro/task_promise.hpp"
 
+#include <utility>
+
 namespace ecoro {
 
 template<typename T, typename Promise = task_promise<T>,
@@ -46,7 +48,9 @@ class task {
   task(const task &) = delete;
   task &operator=(const task &) = delete;
 
-  virtual ~task() {
+  // Not virtual: derived tasks only add behaviour, never state that needs
+  // polymorphic destruction, so a task stays a single handle.
+  ~task() {
     clear();
   }
 
@@ -60,6 +64,12 @@ class task {
     }
   }
 
+  void set_stop_token(stop_token token) noexcept {
+    if (handle_) {
+      handle_.promise().set_stop_token(std::move(token));
+    }
+  }
+
   void clear() {
     if (handle_) {
       handle_.destroy();
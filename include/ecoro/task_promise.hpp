@@ -7,6 +7,8 @@
 #define ECORO_TASK_PROMISE_HPP
 
 #include "ecoro/detail/task_promise_impl.hpp"
+#include "ecoro/frame_allocator.hpp"
+#include "ecoro/stop_token.hpp"
 
 #if !defined(SYMMETRIC_TRANSFER)
 #  include <atomic>
@@ -17,7 +19,8 @@ namespace ecoro {
 class scheduler;
 
 template<typename T>
-class task_promise : public detail::task_promise_impl<T> {
+class task_promise : public detail::task_promise_impl<T>,
+                     public frame_allocated<> {
   struct final_awaiter {
     bool await_ready() const noexcept {
       return false;
@@ -71,6 +74,14 @@ class task_promise : public detail::task_promise_impl<T> {
       scheduler_ = scheduler;
   }
 
+  const ecoro::stop_token &stop_token() const noexcept {
+    return stop_token_;
+  }
+
+  void set_stop_token(ecoro::stop_token token) noexcept {
+    stop_token_ = std::move(token);
+  }
+
 #if defined(SYMMETRIC_TRANSFER)
   void set_continuation(std::coroutine_handle<> continuation) noexcept {
     continuation_ = continuation;
@@ -90,6 +101,7 @@ class task_promise : public detail::task_promise_impl<T> {
 
  private:
   ecoro::scheduler *scheduler_{nullptr};
+  ecoro::stop_token stop_token_;
 };
 
 }  // namespace ecoro
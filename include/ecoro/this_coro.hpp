@@ -6,8 +6,10 @@
 #ifndef ECORO_THIS_CORO_HPP
 #define ECORO_THIS_CORO_HPP
 
+#include "ecoro/detail/scheduler_operation.hpp"
 #include "ecoro/scheduler.hpp"
-#include "ecoro/task.hpp"
+
+#include <chrono>
 
 namespace ecoro::this_coro {
 
@@ -31,16 +33,105 @@ struct scheduler_awaiter {
   scheduler *scheduler_{nullptr};
 };
 
+// Puts the awaiting coroutine at the back of its scheduler run queue. Without
+// a scheduler the coroutine just continues.
+class yield_awaiter {
+ public:
+  bool await_ready() const noexcept {
+    return false;
+  }
+
+  template<typename Promise>
+  bool await_suspend(std::coroutine_handle<Promise> awaiting_coro) noexcept {
+    auto *scheduler = awaiting_coro.promise().scheduler();
+    if (!scheduler) {
+      return false;
+    }
+
+    operation_.continuation_ = awaiting_coro;
+    scheduler->yield(&operation_);
+    return true;
+  }
+
+  void await_resume() const noexcept {}
+
+ private:
+  ecoro::detail::resume_operation operation_;
+};
+
+// Same as scheduler::timer_awaiter, but takes the scheduler from the
+// awaiting coroutine.
+class sleep_awaiter {
+ public:
+  explicit sleep_awaiter(
+      const std::chrono::steady_clock::time_point deadline) noexcept {
+    operation_.deadline = deadline;
+  }
+
+  bool await_ready() const noexcept {
+    return false;
+  }
+
+  template<typename Promise>
+  void await_suspend(std::coroutine_handle<Promise> awaiting_coro) noexcept {
+    operation_.continuation_ = awaiting_coro;
+    timer_.start(*awaiting_coro.promise().scheduler(), operation_,
+                 awaiting_coro);
+  }
+
+  void await_resume() const {
+    if (operation_.cancelled()) {
+      throw operation_cancelled{};
+    }
+  }
+
+ private:
+  ecoro::detail::timer_operation operation_;
+  ecoro::detail::cancellable_timer timer_;
+};
+
+struct stop_token_awaiter {
+  bool await_ready() const noexcept {
+    return false;
+  }
+
+  template<typename Promise>
+  bool await_suspend(std::coroutine_handle<Promise> awaiting_coro) noexcept {
+    if constexpr (ecoro::detail::has_stop_token<Promise>) {
+      token_ = awaiting_coro.promise().stop_token();
+    }
+    return false;
+  }
+
+  ecoro::stop_token await_resume() const noexcept {
+    return token_;
+  }
+
+  ecoro::stop_token token_;
+};
+
 }  // namespace detail
 
 [[nodiscard]] auto scheduler() noexcept {
   return detail::scheduler_awaiter{};
 }
 
-template<typename Duration>
-[[nodiscard]] task<void> sleep_for(Duration &&duration) {
-  auto *e = co_await scheduler();
-  co_await e->schedule_after(std::forward<Duration>(duration));
+// The stop token of the current coroutine, when_any requests a stop on it
+// once the first branch finishes.
+[[nodiscard]] inline auto stop_token() noexcept {
+  return detail::stop_token_awaiter{};
+}
+
+[[nodiscard]] inline auto yield() noexcept {
+  return detail::yield_awaiter{};
+}
+
+template<typename Rep, typename Period>
+[[nodiscard]] auto sleep_for(
+    const std::chrono::duration<Rep, Period> duration) noexcept {
+  using clock = std::chrono::steady_clock;
+  return detail::sleep_awaiter{
+    clock::now() + std::chrono::ceil<clock::duration>(duration)};
 }
 
 }  // namespace ecoro::this_coro
@@ -0,0 +1,106 @@
+// Copyright 2022 - present, Mikhail Svetkin
+// All rights reserved.
+//
+// For the license information refer to LICENSE
+
+#ifndef ECORO_THREAD_POOL_HPP
+#define ECORO_THREAD_POOL_HPP
+
+#include "ecoro/detail/parker.hpp"
+#include "ecoro/detail/scheduler_operation.hpp"
+#include "ecoro/scheduler.hpp"
+#include "ecoro/scope.hpp"
+#include "ecoro/task.hpp"
+#include "ecoro/timer_wheel.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ecoro {
+
+// Work-stealing thread pool.
+//
+// Every worker owns a Chase-Lev deque and a LIFO slot that holds the most
+// recently scheduled continuation. Work coming from outside of the pool goes
+// to the global injection queue. Idle workers steal from each other before
+// going to sleep.
+class thread_pool : public scheduler {
+ public:
+  // Idle workers spin for spin_count rounds before they go to sleep.
+  explicit thread_pool(
+      std::size_t thread_count = std::thread::hardware_concurrency(),
+      std::size_t spin_count = detail::parker::default_spin_count);
+  ~thread_pool();
+
+  thread_pool(const thread_pool &) = delete;
+  thread_pool &operator=(const thread_pool &) = delete;
+
+  // Unlike scope::spawn the work starts on one of the workers, not inline.
+  // The callable is kept alive in the spawned frame, lvalue arguments are
+  // passed by reference and rvalue ones are moved into the frame.
+  template<typename Awaitable, typename... Args>
+  void spawn(Awaitable &&awaitable, Args &&...args) {
+    scope_.spawn(run_on_pool<std::decay_t<Awaitable>, Args...>(
+        std::forward<Awaitable>(awaitable), std::forward<Args>(args)...));
+  }
+
+  [[nodiscard]] auto join() noexcept {
+    return scope_.join();
+  }
+
+  void enqueue(detail::scheduler_operation *operation) noexcept override;
+  void yield(detail::scheduler_operation *operation) noexcept override;
+  void add_timer(detail::timer_operation &operation) noexcept override;
+  bool cancel_timer(detail::timer_operation &operation) noexcept override;
+
+  std::size_t thread_count() const noexcept;
+
+ private:
+  struct worker;
+
+  template<typename Awaitable, typename... Args>
+  task<void> run_on_pool(Awaitable awaitable, Args... args) {
+    co_await schedule();
+    co_await detail::invoke_or_pass(awaitable, std::forward<Args>(args)...);
+  }
+
+  void run(worker &self);
+  detail::scheduler_operation *next_operation(worker &self);
+  void inject(detail::scheduler_operation *operation) noexcept;
+  detail::scheduler_operation *pop_injected() noexcept;
+  detail::scheduler_operation *steal(worker &self) noexcept;
+  bool process_timers(worker &self);
+  void wait_for_work(worker &self);
+  bool has_pending_work() const noexcept;
+  void notify_one() noexcept;
+  worker *pop_idle_worker() noexcept;
+  void remove_idle_worker(worker &self) noexcept;
+
+  void update_next_timer() noexcept;
+
+  static thread_local worker *current_worker_;
+
+  std::vector<std::unique_ptr<worker>> workers_;
+
+  mutable std::mutex mutex_;
+  std::vector<worker *> idle_workers_;
+  detail::operation_queue injection_queue_;
+  std::atomic<bool> has_injected_{false};
+  timer_wheel timers_;
+  std::atomic<std::int64_t> next_timer_{INT64_MAX};
+  worker *timer_keeper_{nullptr};
+  std::chrono::steady_clock::time_point timer_keeper_deadline_;
+  std::atomic<std::size_t> sleepers_{0};
+  std::atomic<bool> stopping_{false};
+
+  scope scope_{this};
+};
+
+}  // namespace ecoro
+
+#endif  // ECORO_THREAD_POOL_HPP
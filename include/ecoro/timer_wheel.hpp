@@ -0,0 +1,111 @@
+// Copyright 2022 - present, Mikhail Svetkin
+// All rights reserved.
+//
+// For the license information refer to LICENSE
+
+#ifndef ECORO_TIMER_WHEEL_HPP
+#define ECORO_TIMER_WHEEL_HPP
+
+#include "ecoro/detail/intrusive/list.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+
+namespace ecoro {
+
+struct timer_node : detail::intrusive::list_node<timer_node> {
+  bool pending() const noexcept {
+    return next != nullptr;
+  }
+
+  std::chrono::steady_clock::time_point deadline;
+
+ private:
+  friend class timer_wheel;
+
+  std::uint64_t when_{0};
+  std::uint8_t level_{0};
+  std::uint8_t slot_{0};
+};
+
+// Hierarchical timing wheel.
+//
+// Deadlines are rounded up to the wheel resolution, so a timer never fires
+// early. Adding and removing a timer is O(1), expiration is amortized O(1):
+// a timer is moved to a lower level at most once per level.
+//
+// The wheel is not thread-safe, schedulers guard it on their own.
+class timer_wheel {
+ public:
+  using clock = std::chrono::steady_clock;
+
+  static constexpr std::size_t level_count = 6;
+  static constexpr std::size_t slot_bits = 6;
+  static constexpr std::size_t slot_count = std::size_t{1} << slot_bits;
+
+  explicit timer_wheel(clock::duration resolution = std::chrono::milliseconds(1),
+                       clock::time_point start = clock::now()) noexcept;
+
+  timer_wheel(const timer_wheel &) = delete;
+  timer_wheel &operator=(const timer_wheel &) = delete;
+
+  void add(timer_node &node) noexcept;
+
+  // Returns false if the timer has already expired or was never added.
+  bool remove(timer_node &node) noexcept;
+
+  // Calls on_expired for every timer whose deadline is not later than now.
+  // The callback is allowed to add and remove timers.
+  template<typename Callback>
+  std::size_t advance(const clock::time_point now, Callback &&on_expired) {
+    std::size_t count = 0;
+    while (auto *node = poll(now)) {
+      on_expired(*node);
+      ++count;
+    }
+
+    return count;
+  }
+
+  // Returns the time the wheel has to be advanced at, the earliest timer
+  // does not expire before that.
+  [[nodiscard]] std::optional<clock::time_point> next_deadline() const noexcept;
+
+  [[nodiscard]] bool empty() const noexcept;
+  [[nodiscard]] std::size_t size() const noexcept;
+
+ private:
+  struct expiration {
+    std::size_t level;
+    std::size_t slot;
+    std::uint64_t deadline;
+  };
+
+  using slot_list = detail::intrusive::list<timer_node>;
+
+  timer_node *poll(clock::time_point now) noexcept;
+  void insert(timer_node &node) noexcept;
+  std::optional<expiration> next_expiration() const noexcept;
+  void process(const expiration &exp) noexcept;
+
+  std::uint64_t to_ticks(clock::time_point tp, bool round_up) const noexcept;
+  clock::time_point to_time_point(std::uint64_t ticks) const noexcept;
+
+  struct level {
+    std::uint64_t occupied{0};
+    std::array<slot_list, slot_count> slots;
+  };
+
+  clock::duration resolution_;
+  clock::time_point start_;
+  std::uint64_t elapsed_{0};
+  std::size_t size_{0};
+  std::array<level, level_count> levels_;
+  slot_list expired_;
+};
+
+}  // namespace ecoro
+
+#endif  // ECORO_TIMER_WHEEL_HPP
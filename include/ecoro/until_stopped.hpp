@@ -0,0 +1,104 @@
+// Copyright 2022 - present, Mikhail Svetkin
+// All rights reserved.
+//
+// For the license information refer to LICENSE
+
+#ifndef ECORO_UNTIL_STOPPED_HPP
+#define ECORO_UNTIL_STOPPED_HPP
+
+#include "ecoro/coroutine.hpp"
+#include "ecoro/detail/scheduler_operation.hpp"
+#include "ecoro/detail/task_awaitable.hpp"
+#include "ecoro/scheduler.hpp"
+#include "ecoro/stop_token.hpp"
+
+#include <atomic>
+#include <optional>
+#include <utility>
+
+namespace ecoro {
+
+namespace detail {
+
+// The stop callback only hands the coroutine over to its scheduler, so
+// nothing but an enqueue runs on the thread that requested the stop.
+// Without a scheduler the coroutine is resumed right there.
+class until_stopped_awaiter {
+  struct resume_on_stop {
+    void operator()() const noexcept {
+      awaiter_->on_stop();
+    }
+
+    until_stopped_awaiter *awaiter_;
+  };
+
+ public:
+  explicit until_stopped_awaiter(const stop_token &token) noexcept
+      : token_(token) {}
+
+  until_stopped_awaiter(const until_stopped_awaiter &) = delete;
+  until_stopped_awaiter &operator=(const until_stopped_awaiter &) = delete;
+
+  bool await_ready() const noexcept {
+    return token_.stop_requested();
+  }
+
+  template<typename Promise>
+  bool await_suspend(std::coroutine_handle<Promise> awaiting_coroutine) {
+    operation_.continuation_ = awaiting_coroutine;
+    scheduler_ = awaiting_scheduler(awaiting_coroutine);
+
+    // A stop requested meanwhile runs the callback right here, then whoever
+    // comes second of the two resumes.
+    on_stop_.emplace(token_, resume_on_stop{this});
+    return !suspended_.exchange(true, std::memory_order_acq_rel);
+  }
+
+  void await_resume() const noexcept {}
+
+ private:
+  void on_stop() noexcept {
+    if (!suspended_.exchange(true, std::memory_order_acq_rel)) {
+      return;
+    }
+
+    if (scheduler_) {
+      scheduler_->enqueue(&operation_);
+    } else {
+      operation_.continuation_.resume();
+    }
+  }
+
+  stop_token token_;
+  scheduler *scheduler_{nullptr};
+  resume_operation operation_;
+  std::atomic<bool> suspended_{false};
+  std::optional<stop_callback<resume_on_stop>> on_stop_;
+};
+
+class until_stopped_awaitable {
+ public:
+  explicit until_stopped_awaitable(stop_token token) noexcept
+      : token_(std::move(token)) {}
+
+  until_stopped_awaiter operator co_await() const noexcept {
+    return until_stopped_awaiter{token_};
+  }
+
+ private:
+  stop_token token_;
+};
+
+}  // namespace detail
+
+// Completes once a stop is requested on the token, on the scheduler of the
+// awaiting coroutine. Never completes for a token without a stop state.
+// Allocates nothing, so when_first(work, until_stopped(token)) costs no more
+// than the when_first itself.
+[[nodiscard]] inline auto until_stopped(stop_token token) noexcept {
+  return detail::until_stopped_awaitable{std::move(token)};
+}
+
+}  // namespace ecoro
+
+#endif  // ECORO_UNTIL_STOPPED_HPP
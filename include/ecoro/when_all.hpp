@@ -7,39 +7,54 @@
 #define ECORO_WHEN_ALL_HPP
 
 #include "ecoro/awaitable_traits.hpp"
+#include "ecoro/config.hpp"
 #include "ecoro/detail/invoke_or_pass.hpp"
 #include "ecoro/task.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <stdexcept>
 #include <tuple>
 #include <variant>
+#include <vector>
 
 namespace ecoro {
 
 namespace detail {
 
+// Counts the children plus the awaiting coroutine, whoever brings it down to
+// zero resumes the awaiting one. Children may complete on different threads.
 class when_all_counter {
  public:
   explicit when_all_counter(const std::size_t count) noexcept
-      : count_(count) {}
+      : count_(count + 1) {}
 
   bool is_ready() const noexcept {
     return static_cast<bool>(awaiting_coroutine_);
   }
 
   bool try_await(std::coroutine_handle<> awaiting_coroutine) noexcept {
+    // Every child has already finished, typically on the same thread, so
+    // there is nobody to hand the awaiting coroutine over to.
+    if (count_.load(std::memory_order_acquire) == 1) {
+      return false;
+    }
+
     awaiting_coroutine_ = awaiting_coroutine;
-    return ++count_ > 1;
+    return count_.fetch_sub(1, std::memory_order_acq_rel) > 1;
   }
 
   void notify_awaitable_completed() noexcept {
-    count_--;
-    if (count_ == 1) {
+    if (count_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
       awaiting_coroutine_.resume();
     }
   }
 
  protected:
-  std::size_t count_;
+  std::atomic<std::size_t> count_;
   std::coroutine_handle<> awaiting_coroutine_;
 };
 
@@ -92,7 +107,10 @@ class when_all_task final : public task<T, when_all_task_promise<T>> {
   when_all_task(base &&other) noexcept
       : base(std::move(other)) {}
 
-  void start(when_all_counter &counter) noexcept {
+  void start(when_all_counter &counter, scheduler *const scheduler,
+             const stop_token &token) noexcept {
+    base::set_scheduler(scheduler);
+    base::handle().promise().set_stop_token(token);
     base::handle().promise().set_counter(counter);
     base::resume();
   }
@@ -111,8 +129,11 @@ class when_all_executor {
       return executor_.counter_.is_ready();
     }
 
-    bool await_suspend(std::coroutine_handle<> awaiting_coroutine) noexcept {
-      return executor_.start(awaiting_coroutine);
+    template<typename Promise>
+    bool await_suspend(std::coroutine_handle<Promise> awaiting_coroutine) {
+      return executor_.start(awaiting_coroutine,
+                             awaiting_scheduler(awaiting_coroutine),
+                             awaiting_stop_token(awaiting_coroutine));
     }
 
     std::tuple<Awaitables...> await_resume() noexcept {
@@ -135,7 +156,6 @@ class when_all_executor {
 
   when_all_executor &operator=(when_all_executor &&other) noexcept {
     if (std::addressof(other) != this) {
-      counter_ = std::move(other.counter_);
       awaitables_ = std::move(other.awaitables_);
     }
 
@@ -147,15 +167,18 @@ class when_all_executor {
   }
 
  protected:
-  bool start(std::coroutine_handle<> awaiting_coroutine) noexcept {
-    const bool res = counter_.try_await(awaiting_coroutine);
-    start(std::index_sequence_for<Awaitables...>{});
-    return res;
+  bool start(std::coroutine_handle<> awaiting_coroutine,
+             scheduler *const scheduler, const stop_token &token) noexcept {
+    // Children are started first, the awaiting coroutine is published by
+    // try_await() only if some of them are still running.
+    start(scheduler, token, std::index_sequence_for<Awaitables...>{});
+    return counter_.try_await(awaiting_coroutine);
   }
 
   template<std::size_t... Is>
-  void start(std::index_sequence<Is...>) noexcept {
-    (std::get<Is>(awaitables_).start(counter_), ...);
+  void start(scheduler *const scheduler, const stop_token &token,
+             std::index_sequence<Is...>) noexcept {
+    (std::get<Is>(awaitables_).start(counter_, scheduler, token), ...);
   }
 
  private:
@@ -163,6 +186,330 @@ class when_all_executor {
   std::tuple<Awaitables...> awaitables_;
 };
 
+template<typename T>
+class when_all_range_executor {
+  using allocator_type = std::pmr::polymorphic_allocator<std::byte>;
+
+  // Wrapper frames are small and all of them go to one arena, a guess of
+  // their size lets the arena get by with a single upstream allocation.
+  static constexpr std::size_t frame_size_hint = 256;
+
+  struct awaiter {
+    bool await_ready() const noexcept {
+      return executor_.counter_.is_ready();
+    }
+
+    template<typename Promise>
+    bool await_suspend(
+        std::coroutine_handle<Promise> awaiting_coroutine) noexcept {
+      return executor_.start(awaiting_coroutine,
+                             awaiting_scheduler(awaiting_coroutine),
+                             awaiting_stop_token(awaiting_coroutine));
+    }
+
+    auto await_resume() {
+      return executor_.results();
+    }
+
+    when_all_range_executor &executor_;
+  };
+
+ public:
+  explicit when_all_range_executor(std::vector<task<T>> &&tasks)
+      : tasks_(std::move(tasks)),
+        counter_(tasks_.size()),
+        arena_(std::max<std::size_t>(tasks_.size(), 1) * frame_size_hint),
+        wrappers_(allocator_type{&arena_}) {
+    const auto is_empty = [](task<T> &task) { return !task.handle(); };
+    if (std::any_of(tasks_.begin(), tasks_.end(), is_empty)) {
+      throw std::invalid_argument{"when_all over an empty task"};
+    }
+  }
+
+  when_all_range_executor(const when_all_range_executor &) = delete;
+  when_all_range_executor &operator=(const when_all_range_executor &) = delete;
+
+  auto operator co_await() const &noexcept {
+    return awaiter{const_cast<when_all_range_executor &>(*this)};
+  }
+
+ private:
+  ECORO_ALLOCATOR_ARG_COROUTINE_BEGIN
+  static when_all_task<void> make_task(std::allocator_arg_t, allocator_type,
+                                       task<T> &child) {
+    co_await task_ready_awaitable<typename task<T>::promise_type>{
+      {child.handle()}};
+  }
+  ECORO_ALLOCATOR_ARG_COROUTINE_END
+
+  bool start(std::coroutine_handle<> awaiting_coroutine,
+             scheduler *const scheduler, const stop_token &token) {
+    wrappers_.reserve(tasks_.size());
+    for (auto &task : tasks_) {
+      wrappers_.push_back(make_task(std::allocator_arg, allocator_type{&arena_},
+                                    task));
+    }
+
+    for (auto &wrapper : wrappers_) {
+      wrapper.start(counter_, scheduler, token);
+    }
+
+    return counter_.try_await(awaiting_coroutine);
+  }
+
+  auto results() {
+    if constexpr (std::is_void_v<T>) {
+      for (auto &task : tasks_) {
+        task.result();
+      }
+    } else {
+      std::vector<T> results;
+      results.reserve(tasks_.size());
+      for (auto &task : tasks_) {
+        results.push_back(task.result());
+      }
+
+      return results;
+    }
+  }
+
+  std::vector<task<T>> tasks_;
+  when_all_counter counter_;
+  std::pmr::monotonic_buffer_resource arena_;
+  std::pmr::vector<when_all_task<void>> wrappers_;
+};
+
+// Where a when_all_results child stores its outcome. The child frame is
+// gone by the time the result is taken.
+template<typename T>
+using when_all_result_slot = task_promise_impl<T>;
+
+template<typename T>
+class when_all_result_task;
+
+template<typename T>
+class when_all_result_promise_base : public frame_allocated<> {
+  struct final_awaiter {
+    bool await_ready() const noexcept {
+      return false;
+    }
+
+    template<typename Promise>
+    void await_suspend(std::coroutine_handle<Promise> coroutine) noexcept {
+      // The frame goes first, the counter may resume the awaiting coroutine
+      // which then releases everything else.
+      auto *counter = coroutine.promise().counter_;
+      coroutine.destroy();
+      counter->notify_awaitable_completed();
+    }
+
+    void await_resume() const noexcept {}
+  };
+
+ public:
+  std::suspend_always initial_suspend() const noexcept {
+    return {};
+  }
+
+  final_awaiter final_suspend() const noexcept {
+    return {};
+  }
+
+  void unhandled_exception() noexcept {
+    slot_->unhandled_exception();
+  }
+
+  ecoro::scheduler *scheduler() const noexcept {
+    return scheduler_;
+  }
+
+  void set_scheduler(ecoro::scheduler *scheduler) noexcept {
+    scheduler_ = scheduler;
+  }
+
+  const ecoro::stop_token &stop_token() const noexcept {
+    return stop_token_;
+  }
+
+  void set_stop_token(ecoro::stop_token token) noexcept {
+    stop_token_ = std::move(token);
+  }
+
+  void start(when_all_counter &counter, when_all_result_slot<T> &slot) {
+    counter_ = &counter;
+    slot_ = &slot;
+  }
+
+ protected:
+  ecoro::scheduler *scheduler_{nullptr};
+  ecoro::stop_token stop_token_;
+  when_all_counter *counter_{nullptr};
+  when_all_result_slot<T> *slot_{nullptr};
+};
+
+template<typename T>
+class when_all_result_promise : public when_all_result_promise_base<T> {
+ public:
+  when_all_result_task<T> get_return_object() noexcept;
+
+  template<typename U>
+  void return_value(U &&value) noexcept(
+      noexcept(this->slot_->return_value(std::forward<U>(value)))) {
+    this->slot_->return_value(std::forward<U>(value));
+  }
+};
+
+template<>
+class when_all_result_promise<void> : public when_all_result_promise_base<void> {
+ public:
+  when_all_result_task<void> get_return_object() noexcept;
+
+  void return_void() const noexcept {}
+};
+
+// Owns the child frame only until it is started, afterwards the frame
+// destroys itself as soon as it finishes. A started child always gets
+// there: a wait cancelled through its stop token resumes with
+// operation_cancelled.
+template<typename T>
+class when_all_result_task {
+ public:
+  using promise_type = when_all_result_promise<T>;
+  using handle_type = std::coroutine_handle<promise_type>;
+
+  explicit when_all_result_task(handle_type handle) noexcept
+      : handle_(handle) {}
+
+  when_all_result_task(when_all_result_task &&other) noexcept
+      : handle_(std::exchange(other.handle_, nullptr)) {}
+
+  when_all_result_task &operator=(when_all_result_task &&other) noexcept {
+    if (std::addressof(other) != this) {
+      if (handle_) {
+        handle_.destroy();
+      }
+      handle_ = std::exchange(other.handle_, nullptr);
+    }
+
+    return *this;
+  }
+
+  ~when_all_result_task() {
+    if (handle_) {
+      handle_.destroy();
+    }
+  }
+
+  void start(when_all_counter &counter, when_all_result_slot<T> &slot,
+             scheduler *const scheduler, const stop_token &token) {
+    auto handle = std::exchange(handle_, nullptr);
+    handle.promise().set_scheduler(scheduler);
+    handle.promise().set_stop_token(token);
+    handle.promise().start(counter, slot);
+    handle.resume();
+  }
+
+ private:
+  handle_type handle_;
+};
+
+template<typename T>
+when_all_result_task<T> when_all_result_promise<T>::get_return_object() noexcept {
+  return when_all_result_task<T>{
+    std::coroutine_handle<when_all_result_promise>::from_promise(*this)};
+}
+
+inline when_all_result_task<void>
+when_all_result_promise<void>::get_return_object() noexcept {
+  return when_all_result_task<void>{
+    std::coroutine_handle<when_all_result_promise>::from_promise(*this)};
+}
+
+template<typename Awaitable>
+when_all_result_task<awaitable_return_type<Awaitable>> make_when_all_result_task(
+    Awaitable awaitable) {
+  co_return co_await awaitable;
+}
+
+template<typename T>
+using when_all_result_t =
+    std::conditional_t<std::is_void_v<T>, std::monostate, T>;
+
+template<typename... Ts>
+class when_all_results_executor {
+  struct awaiter {
+    bool await_ready() const noexcept {
+      return executor_.counter_.is_ready();
+    }
+
+    template<typename Promise>
+    bool await_suspend(
+        std::coroutine_handle<Promise> awaiting_coroutine) noexcept {
+      return executor_.start(awaiting_coroutine,
+                             awaiting_scheduler(awaiting_coroutine),
+                             awaiting_stop_token(awaiting_coroutine),
+                             std::index_sequence_for<Ts...>{});
+    }
+
+    std::tuple<when_all_result_t<Ts>...> await_resume() {
+      return executor_.results(std::index_sequence_for<Ts...>{});
+    }
+
+    when_all_results_executor &executor_;
+  };
+
+ public:
+  explicit when_all_results_executor(
+      when_all_result_task<Ts> &&...tasks) noexcept
+      : counter_(sizeof...(Ts)),
+        tasks_(std::move(tasks)...) {}
+
+  when_all_results_executor(when_all_results_executor &&other) noexcept
+      : counter_(sizeof...(Ts)),
+        tasks_(std::move(other.tasks_)) {}
+
+  auto operator co_await() const &noexcept {
+    return awaiter{const_cast<when_all_results_executor &>(*this)};
+  }
+
+ private:
+  template<std::size_t... Is>
+  bool start(std::coroutine_handle<> awaiting_coroutine,
+             scheduler *const scheduler, const stop_token &token,
+             std::index_sequence<Is...>) noexcept {
+    (std::get<Is>(tasks_).start(counter_, std::get<Is>(slots_), scheduler,
+                                token),
+     ...);
+    return counter_.try_await(awaiting_coroutine);
+  }
+
+  template<typename T>
+  static when_all_result_t<T> take(when_all_result_slot<T> &slot) {
+    if constexpr (std::is_void_v<T>) {
+      slot.result();
+      return {};
+    } else {
+      return slot.result();
+    }
+  }
+
+  template<std::size_t... Is>
+  std::tuple<when_all_result_t<Ts>...> results(std::index_sequence<Is...>) {
+    // Braced initialization keeps the order, so the first exception wins.
+    return std::tuple<when_all_result_t<Ts>...>{
+      take<Ts>(std::get<Is>(slots_))...};
+  }
+
+  when_all_counter counter_;
+  std::tuple<when_all_result_task<Ts>...> tasks_;
+  std::tuple<when_all_result_slot<Ts>...> slots_;
+};
+
+template<typename... Ts>
+auto make_when_all_results_executor(when_all_result_task<Ts> &&...tasks) {
+  return when_all_results_executor<Ts...>(std::move(tasks)...);
+}
+
 template<typename... Awaitables>
 decltype(auto) make_when_all_executor(Awaitables &&...awaitables) {
   return when_all_executor<Awaitables...>(
@@ -177,6 +524,26 @@ template<typename... Awaitables>
       detail::invoke_or_pass(std::forward<Awaitables>(awaitables)))...);
 }
 
+// Same as when_all, but returns the results instead of the finished tasks.
+// Every child frame is destroyed as soon as it finishes, results of
+// task<void> children are std::monostate.
+template<typename... Awaitables>
+[[nodiscard]] auto when_all_results(Awaitables &&...awaitables) {
+  return detail::make_when_all_results_executor(
+      detail::make_when_all_result_task(
+          detail::invoke_or_pass(std::forward<Awaitables>(awaitables)))...);
+}
+
+// Runs all the tasks and returns their results in the same order. The first
+// exception thrown by a task, in order, is rethrown once all of them finish.
+// Throws std::invalid_argument if one of the tasks is empty.
+template<typename T>
+[[nodiscard]] auto when_all(std::vector<task<T>> &&tasks) {
+  static_assert(!std::is_reference_v<T>,
+                "when_all over a range does not support reference results");
+  return detail::when_all_range_executor<T>{std::move(tasks)};
+}
+
 }  // namespace ecoro
 
 #endif  // ECORO_WHEN_ALL_HPP
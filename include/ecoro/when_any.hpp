@@ -7,45 +7,113 @@
 #define ECORO_WHEN_ANY_HPP
 
 #include "ecoro/awaitable_traits.hpp"
+#include "ecoro/config.hpp"
+#include "ecoro/detail/detachable_frame.hpp"
 #include "ecoro/detail/invoke_or_pass.hpp"
+#include "ecoro/stop_token.hpp"
 #include "ecoro/task.hpp"
 
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <stdexcept>
 #include <tuple>
 #include <variant>
+#include <vector>
 
 namespace ecoro {
 
+// What a when_any over a range of tasks resolves to: the index of the task
+// that finished first and its result.
+template<typename T>
+struct when_any_range_result {
+  std::size_t index;
+  T value;
+};
+
+template<>
+struct when_any_range_result<void> {
+  std::size_t index;
+};
+
 namespace detail {
 
+// The first completed child wins: a compare-and-swap on the completed index
+// decides it, without locks. The winner requests a stop on the token shared
+// by all children, so that the others unwind, and resumes the awaiting
+// coroutine right away.
+//
+// The losers finish on their own, possibly on other threads, each of them
+// holds a reference to the observer until it is done with it.
 class when_any_observer {
  public:
   explicit when_any_observer(const std::size_t awaitables_count) noexcept
-      : completed_index_(awaitables_count) {}
+      : none_(awaitables_count),
+        completed_index_(awaitables_count) {}
+
+  virtual ~when_any_observer() = default;
+
+  when_any_observer(const when_any_observer &) = delete;
+  when_any_observer &operator=(const when_any_observer &) = delete;
 
+  // The children stop with the parent too, but a stop of theirs does not
+  // reach the parent.
+  stop_token start(const stop_token &parent) {
+    stop_source_ = stop_source{parent};
+    return stop_source_.get_token();
+  }
+
+  // Whoever comes second of the winner and set_continuation() resumes.
   bool set_continuation(std::coroutine_handle<> awaiting_coroutine) noexcept {
     awaiting_coroutine_ = awaiting_coroutine;
-    return true;
+    return !resumable_.exchange(true, std::memory_order_acq_rel);
   }
 
   void on_awaitable_completed(const std::size_t index) noexcept {
-    completed_index_ = index;
-    if (awaiting_coroutine_) {
-      awaiting_coroutine_.resume();
+    auto expected = none_;
+    if (!completed_index_.compare_exchange_strong(expected, index,
+                                                  std::memory_order_acq_rel,
+                                                  std::memory_order_relaxed)) {
       return;
     }
+
+    stop_source_.request_stop();
+    if (resumable_.exchange(true, std::memory_order_acq_rel)) {
+      awaiting_coroutine_.resume();
+    }
+  }
+
+  bool completed() const noexcept {
+    return completed_index_.load(std::memory_order_acquire) != none_;
   }
 
   std::size_t completed_index() const noexcept {
-    return completed_index_;
+    return completed_index_.load(std::memory_order_acquire);
+  }
+
+  void retain() noexcept {
+    references_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void release() noexcept {
+    if (references_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      delete this;
+    }
   }
 
  private:
-  std::size_t completed_index_;
+  const std::size_t none_;
+  std::atomic<std::size_t> completed_index_;
+  std::atomic<std::size_t> references_{1};
+  std::atomic<bool> resumable_{false};
+  stop_source stop_source_{nostopstate};
   std::coroutine_handle<> awaiting_coroutine_;
 };
 
 template<std::size_t Index, typename T>
-class when_any_task_promise : public task_promise<T> {
+class when_any_task_promise : public task_promise<T>,
+                              public detachable_frame {
   struct final_awaiter {
     bool await_ready() const noexcept {
       return false;
@@ -54,7 +122,15 @@ class when_any_task_promise : public task_promise<T> {
     template<typename Promise>
     void await_suspend(
         std::coroutine_handle<Promise> current_coroutine) noexcept {
-      current_coroutine.promise().observer_->on_awaitable_completed(Index);
+      auto &promise = current_coroutine.promise();
+      auto *observer = promise.observer_;
+      observer->on_awaitable_completed(Index);
+
+      // The owner of the result may have let go of the frame meanwhile.
+      if (promise.on_finished()) {
+        current_coroutine.destroy();
+      }
+      observer->release();
     }
 
     void await_resume() noexcept {}
@@ -84,6 +160,8 @@ class when_any_task_promise : public task_promise<T> {
   when_any_observer *observer_{nullptr};
 };
 
+// Destroying a child that is still running leaves its frame to destroy
+// itself once it finishes.
 template<std::size_t Index, typename T>
 class when_any_task final : public task<T, when_any_task_promise<Index, T>> {
  public:
@@ -92,8 +170,29 @@ class when_any_task final : public task<T, when_any_task_promise<Index, T>> {
 
   when_any_task(base &&other) noexcept : base(std::move(other)) {}
 
-  void resume(when_any_observer &observer) noexcept {
-    base::handle().promise().set_observer(observer);
+  when_any_task(when_any_task &&other) noexcept = default;
+
+  when_any_task &operator=(when_any_task &&other) noexcept {
+    if (std::addressof(other) != this) {
+      detach_frame(base::handle());
+      base::operator=(std::move(other));
+    }
+
+    return *this;
+  }
+
+  ~when_any_task() {
+    detach_frame(base::handle());
+  }
+
+  void resume(when_any_observer &observer, scheduler *const scheduler,
+              const stop_token &token) noexcept {
+    auto &promise = base::handle().promise();
+    observer.retain();
+    promise.set_scheduler(scheduler);
+    promise.set_stop_token(token);
+    promise.set_observer(observer);
+    promise.on_started();
     base::resume();
   }
 };
@@ -127,12 +226,15 @@ class when_any_executor {
       return false;
     }
 
-    bool await_suspend(std::coroutine_handle<> awaiting_coroutine) noexcept {
-      return executor_.start(awaiting_coroutine);
+    template<typename Promise>
+    bool await_suspend(std::coroutine_handle<Promise> awaiting_coroutine) {
+      return executor_.start(awaiting_coroutine,
+                             awaiting_scheduler(awaiting_coroutine),
+                             awaiting_stop_token(awaiting_coroutine));
     }
 
     result await_resume() noexcept {
-      return {executor_.observer_.completed_index(),
+      return {executor_.observer_->completed_index(),
               std::move(executor_.awaitables_)};
     }
 
@@ -146,48 +248,194 @@ class when_any_executor {
 
   explicit when_any_executor(when_any_executor &&other) noexcept(
       std::conjunction_v<std::is_nothrow_move_constructible<Awaitables>...>)
-      : observer_(std::move(other.observer_)),
-        awaitables_(std::exchange(other.awaitables_, {})) {}
+      : awaitables_(std::exchange(other.awaitables_, {})) {}
 
   when_any_executor &operator=(when_any_executor &&other) noexcept(
       std::conjunction_v<std::is_nothrow_move_constructible<Awaitables>...>) {
     if (std::addressof(other) != this) {
-      observer_ = std::move(other.observer_);
       awaitables_ = std::move(other.awaitables_);
     }
 
     return *this;
   }
 
+  ~when_any_executor() {
+    if (observer_) {
+      observer_->release();
+    }
+  }
+
   auto operator co_await() noexcept {
     return awaiter{const_cast<when_any_executor &>(*this)};
   }
 
  protected:
-  bool start(std::coroutine_handle<> awaiting_coroutine) noexcept {
-    std::apply([this](auto &&...args) { (start(args), ...); }, awaitables_);
+  bool start(std::coroutine_handle<> awaiting_coroutine,
+             scheduler *const scheduler, const stop_token &parent_token) {
+    observer_ = new when_any_observer{sizeof...(Awaitables)};
+    const auto token = observer_->start(parent_token);
+    std::apply(
+        [&](auto &&...args) { (start_one(args, scheduler, token), ...); },
+        awaitables_);
+
+    return observer_->set_continuation(awaiting_coroutine);
+  }
+
+  template<typename Awaitable>
+  void start_one(Awaitable &awaitable, scheduler *const scheduler,
+                 const stop_token &token) noexcept {
+    if (!observer_->completed()) {
+      awaitable.resume(*observer_, scheduler, token);
+    }
+  }
+
+ private:
+  when_any_observer *observer_{nullptr};
+  storage_type awaitables_;
+};
 
-    if (finished()) {
+// One promise type serves every child of a ranged when_any, the index is
+// known only at run time. The wrapper destroys itself once its child has
+// finished, the children themselves and the arena of the wrappers are kept
+// by the observer, so they outlive the executor as long as some wrapper
+// still runs.
+class when_any_range_task_promise : public task_promise<void> {
+  struct final_awaiter {
+    bool await_ready() const noexcept {
       return false;
     }
 
-    observer_.set_continuation(awaiting_coroutine);
-    return true;
+    template<typename Promise>
+    void await_suspend(
+        std::coroutine_handle<Promise> current_coroutine) noexcept {
+      // The frame goes first, the observer may resume the awaiting
+      // coroutine which then releases everything else.
+      auto &promise = current_coroutine.promise();
+      auto *observer = promise.observer_;
+      const auto index = promise.index_;
+      current_coroutine.destroy();
+
+      observer->on_awaitable_completed(index);
+      observer->release();
+    }
+
+    void await_resume() noexcept {}
+  };
+
+ public:
+  final_awaiter final_suspend() noexcept {
+    return {};
   }
 
-  template<typename Awaitable>
-  void start(Awaitable &awaitable) noexcept {
-    if (!finished())
-      awaitable.resume(observer_);
+  void set_observer(when_any_observer &observer,
+                    const std::size_t index) noexcept {
+    observer_ = &observer;
+    index_ = index;
   }
 
-  bool finished() const noexcept {
-    return observer_.completed_index() < sizeof...(Awaitables);
+ private:
+  when_any_observer *observer_{nullptr};
+  std::size_t index_{0};
+};
+
+using when_any_range_task = task<void, when_any_range_task_promise>;
+
+template<typename T>
+class when_any_range_executor {
+  using allocator_type = std::pmr::polymorphic_allocator<std::byte>;
+
+  // Same idea as in when_all: all wrapper frames share one arena.
+  static constexpr std::size_t frame_size_hint = 256;
+
+  struct state final : when_any_observer {
+    explicit state(std::vector<task<T>> &&tasks)
+        : when_any_observer(tasks.size()),
+          tasks(std::move(tasks)),
+          arena(this->tasks.size() * frame_size_hint) {}
+
+    std::vector<task<T>> tasks;
+    std::pmr::monotonic_buffer_resource arena;
+  };
+
+  struct awaiter {
+    bool await_ready() const noexcept {
+      return false;
+    }
+
+    template<typename Promise>
+    bool await_suspend(std::coroutine_handle<Promise> awaiting_coroutine) {
+      return executor_.start(awaiting_coroutine,
+                             awaiting_scheduler(awaiting_coroutine),
+                             awaiting_stop_token(awaiting_coroutine));
+    }
+
+    when_any_range_result<T> await_resume() {
+      return executor_.result();
+    }
+
+    when_any_range_executor &executor_;
+  };
+
+ public:
+  explicit when_any_range_executor(std::vector<task<T>> &&tasks) {
+    if (tasks.empty()) {
+      throw std::invalid_argument{"when_any over an empty range"};
+    }
+
+    state_ = new state{std::move(tasks)};
+  }
+
+  when_any_range_executor(const when_any_range_executor &) = delete;
+  when_any_range_executor &operator=(const when_any_range_executor &) = delete;
+
+  ~when_any_range_executor() {
+    state_->release();
+  }
+
+  auto operator co_await() noexcept {
+    return awaiter{*this};
   }
 
  private:
-  when_any_observer observer_{sizeof...(Awaitables)};
-  storage_type awaitables_;
+  ECORO_ALLOCATOR_ARG_COROUTINE_BEGIN
+  static when_any_range_task make_task(std::allocator_arg_t, allocator_type,
+                                       task<T> &child) {
+    co_await task_ready_awaitable<typename task<T>::promise_type>{
+      {child.handle()}};
+  }
+  ECORO_ALLOCATOR_ARG_COROUTINE_END
+
+  bool start(std::coroutine_handle<> awaiting_coroutine,
+             scheduler *const scheduler, const stop_token &parent_token) {
+    const auto token = state_->start(parent_token);
+    for (std::size_t i = 0;
+         i < state_->tasks.size() && !state_->completed(); ++i) {
+      auto wrapper = make_task(std::allocator_arg,
+                               allocator_type{&state_->arena},
+                               state_->tasks[i]);
+
+      auto handle = std::exchange(wrapper.handle(), nullptr);
+      state_->retain();
+      handle.promise().set_scheduler(scheduler);
+      handle.promise().set_stop_token(token);
+      handle.promise().set_observer(*state_, i);
+      handle.resume();
+    }
+
+    return state_->set_continuation(awaiting_coroutine);
+  }
+
+  when_any_range_result<T> result() {
+    const auto index = state_->completed_index();
+    if constexpr (std::is_void_v<T>) {
+      state_->tasks[index].result();
+      return {index};
+    } else {
+      return {index, state_->tasks[index].result()};
+    }
+  }
+
+  state *state_{nullptr};
 };
 
 template<typename... Awaitables>
@@ -206,12 +454,30 @@ template<std::size_t... Indexes, typename... Awaitables>
 
 }  // namespace detail
 
+// Starts the awaitables one by one until one of them finishes, then cancels
+// the rest through their stop token and resumes without waiting for them.
+// Resolves to the index of the first finished awaitable and the awaitables
+// themselves, only the first finished one has a result to take.
+//
+// A loser still running at that point finishes in the background and its
+// frame is freed once it does, so whatever it refers to has to outlive it.
+// A loser that never finishes, because it ignores the stop, is never freed.
 template<typename... Awaitables>
 [[nodiscard]] decltype(auto) when_any(Awaitables &&...awaitables) {
   return detail::when_any(std::index_sequence_for<Awaitables...>{},
                           std::forward<Awaitables>(awaitables)...);
 }
 
+// Same over a range of tasks, resolves to the index and the result of the
+// first finished task. Rethrows if that task failed. The range must not be
+// empty.
+template<typename T>
+[[nodiscard]] auto when_any(std::vector<task<T>> &&tasks) {
+  static_assert(!std::is_reference_v<T>,
+                "when_any over a range does not support reference results");
+  return detail::when_any_range_executor<T>{std::move(tasks)};
+}
+
 }  // namespace ecoro
 
 #endif  // ECORO_WHEN_ANY_HPP
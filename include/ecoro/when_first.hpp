@@ -14,6 +14,11 @@
 
 namespace ecoro {
 
+// Races the awaitable against a trigger that finishes once the awaitable is
+// not worth waiting for anymore, a timeout or until_stopped(token) for
+// example. Resolves to the result of the awaitable if it finishes first and
+// to std::nullopt if the trigger does. As in when_any, the loser is
+// cancelled through its stop token and not waited for.
 template<typename Awaitable, typename Trigger>
 [[nodiscard]] task<std::optional<awaitable_return_type<Awaitable>>> when_first(
     Awaitable awaitable, Trigger trigger) {
@@ -0,0 +1,551 @@
+// Copyright 2022 - present, Mikhail Svetkin
+// All rights reserved.
+//
+// For the license information refer to LICENSE
+
+#ifndef ECORO_WHEN_N_HPP
+#define ECORO_WHEN_N_HPP
+
+#include "ecoro/awaitable_traits.hpp"
+#include "ecoro/config.hpp"
+#include "ecoro/detail/detachable_frame.hpp"
+#include "ecoro/detail/invoke_or_pass.hpp"
+#include "ecoro/stop_token.hpp"
+#include "ecoro/task.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <stdexcept>
+#include <tuple>
+#include <variant>
+#include <vector>
+
+namespace ecoro {
+
+// One entry of what a when_n over a range of tasks resolves to: the index of
+// a task that succeeded and its result.
+template<typename T>
+struct when_n_result {
+  std::size_t index;
+  T value;
+};
+
+template<>
+struct when_n_result<void> {
+  std::size_t index;
+};
+
+namespace detail {
+
+inline void check_when_n_quorum(const std::size_t awaitables_count,
+                                const std::size_t quorum) {
+  if (quorum == 0 || quorum > awaitables_count) {
+    throw std::invalid_argument{"when_n quorum out of range"};
+  }
+}
+
+// Counts successes and failures of the children. The quorum-th success or
+// the failure that makes the quorum unreachable decides the wait: it
+// requests a stop on the token shared by all children and resumes the
+// awaiting coroutine. Both can not happen, there are not enough children
+// for that.
+//
+// The children that are still running then finish on their own, each of
+// them holds a reference to the observer until it is done with it.
+class when_n_observer {
+ public:
+  when_n_observer(const std::size_t awaitables_count, const std::size_t quorum)
+      : count_(awaitables_count),
+        quorum_(quorum),
+        indexes_(quorum) {}
+
+  virtual ~when_n_observer() = default;
+
+  when_n_observer(const when_n_observer &) = delete;
+  when_n_observer &operator=(const when_n_observer &) = delete;
+
+  // The children stop with the parent too, but a stop of theirs does not
+  // reach the parent.
+  stop_token start(const stop_token &parent) {
+    stop_source_ = stop_source{parent};
+    return stop_source_.get_token();
+  }
+
+  // Whoever comes second of the decision and set_continuation() resumes.
+  bool set_continuation(std::coroutine_handle<> awaiting_coroutine) noexcept {
+    awaiting_coroutine_ = awaiting_coroutine;
+    return !resumable_.exchange(true, std::memory_order_acq_rel);
+  }
+
+  void on_awaitable_completed(const std::size_t index,
+                              const bool succeeded) noexcept {
+    if (!decides(index, succeeded)) {
+      return;
+    }
+
+    completed_.store(true, std::memory_order_release);
+    stop_source_.request_stop();
+    if (resumable_.exchange(true, std::memory_order_acq_rel)) {
+      awaiting_coroutine_.resume();
+    }
+  }
+
+  bool completed() const noexcept {
+    return completed_.load(std::memory_order_acquire);
+  }
+
+  bool quorum_reached() const noexcept {
+    return succeeded_.load(std::memory_order_acquire) == quorum_;
+  }
+
+  std::size_t quorum() const noexcept {
+    return quorum_;
+  }
+
+  // Indexes of the succeeded children in completion order, valid once the
+  // quorum is reached.
+  const std::vector<std::size_t> &indexes() const noexcept {
+    return indexes_;
+  }
+
+  // The child whose failure made the quorum unreachable.
+  std::size_t failed_index() const noexcept {
+    return failed_index_;
+  }
+
+  void retain() noexcept {
+    references_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void release() noexcept {
+    if (references_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      delete this;
+    }
+  }
+
+ private:
+  bool decides(const std::size_t index, const bool succeeded) noexcept {
+    if (succeeded) {
+      // The slot is written before the success is counted, so whoever
+      // counts the last one sees all of them.
+      const auto slot = claimed_.fetch_add(1, std::memory_order_relaxed);
+      if (slot >= quorum_) {
+        return false;
+      }
+
+      indexes_[slot] = index;
+      return succeeded_.fetch_add(1, std::memory_order_acq_rel) + 1 == quorum_;
+    }
+
+    if (failed_.fetch_add(1, std::memory_order_acq_rel) + 1 !=
+        count_ - quorum_ + 1) {
+      return false;
+    }
+
+    failed_index_ = index;
+    return true;
+  }
+
+  const std::size_t count_;
+  const std::size_t quorum_;
+  std::vector<std::size_t> indexes_;
+  std::size_t failed_index_{0};
+  std::atomic<std::size_t> claimed_{0};
+  std::atomic<std::size_t> succeeded_{0};
+  std::atomic<std::size_t> failed_{0};
+  std::atomic<std::size_t> references_{1};
+  std::atomic<bool> completed_{false};
+  std::atomic<bool> resumable_{false};
+  stop_source stop_source_{nostopstate};
+  std::coroutine_handle<> awaiting_coroutine_;
+};
+
+template<typename T>
+class when_n_task_promise : public task_promise<T>, public detachable_frame {
+  struct final_awaiter {
+    bool await_ready() const noexcept {
+      return false;
+    }
+
+    template<typename Promise>
+    void await_suspend(
+        std::coroutine_handle<Promise> current_coroutine) noexcept {
+      auto &promise = current_coroutine.promise();
+      auto *observer = promise.observer_;
+      observer->on_awaitable_completed(promise.index_,
+                                       !promise.has_exception());
+
+      // The owner of the result may have let go of the frame meanwhile.
+      if (promise.on_finished()) {
+        current_coroutine.destroy();
+      }
+      observer->release();
+    }
+
+    void await_resume() noexcept {}
+  };
+
+ public:
+  using task_promise<T>::task_promise;
+  using value_type = std::conditional_t<std::is_void_v<T>, std::monostate, T>;
+
+  final_awaiter final_suspend() noexcept {
+    return {};
+  }
+
+  value_type result() {
+    if constexpr (std::is_void_v<T>) {
+      task_promise<T>::result();
+      return {};
+    } else {
+      return task_promise<T>::result();
+    }
+  }
+
+  void set_observer(when_n_observer &observer,
+                    const std::size_t index) noexcept {
+    observer_ = &observer;
+    index_ = index;
+  }
+
+ private:
+  when_n_observer *observer_{nullptr};
+  std::size_t index_{0};
+};
+
+// Destroying a child that is still running leaves its frame to destroy
+// itself once it finishes.
+template<typename T>
+class when_n_task final : public task<T, when_n_task_promise<T>> {
+ public:
+  using base = task<T, when_n_task_promise<T>>;
+  using base::base;
+
+  when_n_task(base &&other) noexcept : base(std::move(other)) {}
+
+  when_n_task(when_n_task &&other) noexcept = default;
+
+  when_n_task &operator=(when_n_task &&other) noexcept {
+    if (std::addressof(other) != this) {
+      detach_frame(base::handle());
+      base::operator=(std::move(other));
+    }
+
+    return *this;
+  }
+
+  ~when_n_task() {
+    detach_frame(base::handle());
+  }
+
+  void resume(when_n_observer &observer, const std::size_t index,
+              scheduler *const scheduler, const stop_token &token) noexcept {
+    auto &promise = base::handle().promise();
+    observer.retain();
+    promise.set_scheduler(scheduler);
+    promise.set_stop_token(token);
+    promise.set_observer(observer, index);
+    promise.on_started();
+    base::resume();
+  }
+};
+
+template<typename Awaitable>
+when_n_task<awaitable_return_type<Awaitable>> make_when_n_task(
+    Awaitable awaitable) {
+  co_return co_await awaitable;
+}
+
+template<typename... Awaitables>
+class when_n_executor {
+  using storage_type = std::tuple<Awaitables...>;
+
+  struct result {
+    std::vector<std::size_t> indexes;
+    storage_type awaitables;
+
+    result(std::vector<std::size_t> indexes, storage_type &&awaitables)
+        : indexes(std::move(indexes)), awaitables(std::move(awaitables)) {}
+
+    result(result &&) noexcept = default;
+    result &operator=(result &&) noexcept = default;
+
+    result(result &) = delete;
+    result operator=(result &) = delete;
+  };
+
+  struct awaiter {
+    bool await_ready() const noexcept {
+      return false;
+    }
+
+    template<typename Promise>
+    bool await_suspend(std::coroutine_handle<Promise> awaiting_coroutine) {
+      return executor_.start(awaiting_coroutine,
+                             awaiting_scheduler(awaiting_coroutine),
+                             awaiting_stop_token(awaiting_coroutine));
+    }
+
+    result await_resume() {
+      return executor_.collect_result();
+    }
+
+    when_n_executor &executor_;
+  };
+
+ public:
+  explicit when_n_executor(const std::size_t quorum,
+                           Awaitables &&...awaitables)
+      : quorum_(quorum),
+        awaitables_(std::forward<Awaitables>(awaitables)...) {
+    check_when_n_quorum(sizeof...(Awaitables), quorum_);
+  }
+
+  when_n_executor(when_n_executor &&other) noexcept(
+      std::conjunction_v<std::is_nothrow_move_constructible<Awaitables>...>)
+      : quorum_(other.quorum_),
+        awaitables_(std::exchange(other.awaitables_, {})) {}
+
+  when_n_executor &operator=(when_n_executor &&) = delete;
+
+  ~when_n_executor() {
+    if (observer_) {
+      observer_->release();
+    }
+  }
+
+  auto operator co_await() noexcept {
+    return awaiter{*this};
+  }
+
+ private:
+  bool start(std::coroutine_handle<> awaiting_coroutine,
+             scheduler *const scheduler, const stop_token &parent_token) {
+    observer_ = new when_n_observer{sizeof...(Awaitables), quorum_};
+    const auto token = observer_->start(parent_token);
+    std::apply(
+        [&](auto &...args) {
+          std::size_t index = 0;
+          ((observer_->completed()
+                ? void()
+                : args.resume(*observer_, index, scheduler, token),
+            ++index),
+           ...);
+        },
+        awaitables_);
+
+    return observer_->set_continuation(awaiting_coroutine);
+  }
+
+  result collect_result() {
+    if (!observer_->quorum_reached()) {
+      std::apply(
+          [failed = observer_->failed_index()](auto &...args) {
+            std::size_t index = 0;
+            ((index++ == failed ? (void)args.result() : void()), ...);
+          },
+          awaitables_);
+    }
+
+    return {observer_->indexes(), std::move(awaitables_)};
+  }
+
+  std::size_t quorum_;
+  when_n_observer *observer_{nullptr};
+  storage_type awaitables_;
+};
+
+// Every child of a ranged when_n is awaited through a wrapper that reports
+// whether the child succeeded and destroys itself once it has. The children
+// themselves and the arena of the wrappers are kept by the observer, so
+// they outlive the executor as long as some wrapper still runs.
+class when_n_range_task_promise : public task_promise<bool> {
+  struct final_awaiter {
+    bool await_ready() const noexcept {
+      return false;
+    }
+
+    template<typename Promise>
+    void await_suspend(
+        std::coroutine_handle<Promise> current_coroutine) noexcept {
+      // The frame goes first, the observer may resume the awaiting
+      // coroutine which then releases everything else.
+      auto &promise = current_coroutine.promise();
+      auto *observer = promise.observer_;
+      const auto index = promise.index_;
+      const bool succeeded = promise.result();
+      current_coroutine.destroy();
+
+      observer->on_awaitable_completed(index, succeeded);
+      observer->release();
+    }
+
+    void await_resume() noexcept {}
+  };
+
+ public:
+  final_awaiter final_suspend() noexcept {
+    return {};
+  }
+
+  void set_observer(when_n_observer &observer,
+                    const std::size_t index) noexcept {
+    observer_ = &observer;
+    index_ = index;
+  }
+
+ private:
+  when_n_observer *observer_{nullptr};
+  std::size_t index_{0};
+};
+
+using when_n_range_task = task<bool, when_n_range_task_promise>;
+
+template<typename T>
+class when_n_range_executor {
+  using allocator_type = std::pmr::polymorphic_allocator<std::byte>;
+
+  // Same idea as in when_all: all wrapper frames share one arena.
+  static constexpr std::size_t frame_size_hint = 256;
+
+  struct state final : when_n_observer {
+    state(const std::size_t quorum, std::vector<task<T>> &&tasks)
+        : when_n_observer(tasks.size(), quorum),
+          tasks(std::move(tasks)),
+          arena(std::max<std::size_t>(this->tasks.size(), 1) *
+                frame_size_hint) {}
+
+    std::vector<task<T>> tasks;
+    std::pmr::monotonic_buffer_resource arena;
+  };
+
+  struct awaiter {
+    bool await_ready() const noexcept {
+      return false;
+    }
+
+    template<typename Promise>
+    bool await_suspend(std::coroutine_handle<Promise> awaiting_coroutine) {
+      return executor_.start(awaiting_coroutine,
+                             awaiting_scheduler(awaiting_coroutine),
+                             awaiting_stop_token(awaiting_coroutine));
+    }
+
+    std::vector<when_n_result<T>> await_resume() {
+      return executor_.result();
+    }
+
+    when_n_range_executor &executor_;
+  };
+
+ public:
+  when_n_range_executor(const std::size_t quorum,
+                        std::vector<task<T>> &&tasks) {
+    check_when_n_quorum(tasks.size(), quorum);
+    state_ = new state{quorum, std::move(tasks)};
+  }
+
+  when_n_range_executor(const when_n_range_executor &) = delete;
+  when_n_range_executor &operator=(const when_n_range_executor &) = delete;
+
+  ~when_n_range_executor() {
+    state_->release();
+  }
+
+  auto operator co_await() noexcept {
+    return awaiter{*this};
+  }
+
+ private:
+  ECORO_ALLOCATOR_ARG_COROUTINE_BEGIN
+  static when_n_range_task make_task(std::allocator_arg_t, allocator_type,
+                                     task<T> &child) {
+    co_await task_ready_awaitable<typename task<T>::promise_type>{
+      {child.handle()}};
+    co_return !child.handle().promise().has_exception();
+  }
+  ECORO_ALLOCATOR_ARG_COROUTINE_END
+
+  bool start(std::coroutine_handle<> awaiting_coroutine,
+             scheduler *const scheduler, const stop_token &parent_token) {
+    const auto token = state_->start(parent_token);
+    for (std::size_t i = 0;
+         i < state_->tasks.size() && !state_->completed(); ++i) {
+      auto wrapper = make_task(std::allocator_arg,
+                               allocator_type{&state_->arena},
+                               state_->tasks[i]);
+
+      auto handle = std::exchange(wrapper.handle(), nullptr);
+      state_->retain();
+      handle.promise().set_scheduler(scheduler);
+      handle.promise().set_stop_token(token);
+      handle.promise().set_observer(*state_, i);
+      handle.resume();
+    }
+
+    return state_->set_continuation(awaiting_coroutine);
+  }
+
+  std::vector<when_n_result<T>> result() {
+    auto &tasks = state_->tasks;
+    if (!state_->quorum_reached()) {
+      tasks[state_->failed_index()].result();
+    }
+
+    std::vector<when_n_result<T>> results;
+    results.reserve(state_->quorum());
+    for (const auto index : state_->indexes()) {
+      if constexpr (std::is_void_v<T>) {
+        results.push_back({index});
+      } else {
+        results.push_back({index, tasks[index].result()});
+      }
+    }
+
+    return results;
+  }
+
+  state *state_{nullptr};
+};
+
+template<typename... Awaitables>
+decltype(auto) make_when_n_executor(const std::size_t quorum,
+                                    Awaitables &&...awaitables) {
+  return when_n_executor<Awaitables...>(
+      quorum, std::forward<Awaitables>(awaitables)...);
+}
+
+}  // namespace detail
+
+// Resumes once `quorum` of the awaitables succeeded and cancels the rest
+// through their stop token, without waiting for them to unwind. Resolves to
+// the indexes of the first `quorum` successes in completion order and the
+// awaitables themselves, only the listed ones have a result to take.
+// Rethrows the failure that made the quorum unreachable.
+//
+// A child still running at that point finishes in the background and its
+// frame is freed once it does, so whatever it refers to has to outlive it.
+template<typename... Awaitables>
+[[nodiscard]] decltype(auto) when_n(const std::size_t quorum,
+                                    Awaitables &&...awaitables) {
+  return detail::make_when_n_executor(
+      quorum, detail::make_when_n_task(
+                  detail::invoke_or_pass(std::forward<Awaitables>(awaitables)))...);
+}
+
+// Same over a range of tasks, resolves to the indexes and values of the first
+// `quorum` successes in completion order.
+template<typename T>
+[[nodiscard]] auto when_n(const std::size_t quorum,
+                          std::vector<task<T>> &&tasks) {
+  static_assert(!std::is_reference_v<T>,
+                "when_n over a range does not support reference results");
+  return detail::when_n_range_executor<T>{quorum, std::move(tasks)};
+}
+
+}  // namespace ecoro
+
+#endif  // ECORO_WHEN_N_HPP
@@ -0,0 +1,108 @@
+// Copyright 2022 - present, Mikhail Svetkin
+// All rights reserved.
+//
+// For the license information refer to LICENSE
+
+#include "ecoro/frame_allocator.hpp"
+
+#include <array>
+
+namespace ecoro {
+
+namespace {
+
+constexpr std::size_t class_count =
+    pooled_frame_allocator::max_size / pooled_frame_allocator::granularity;
+
+std::size_t size_class(const std::size_t size) noexcept {
+  return (size - 1) / pooled_frame_allocator::granularity;
+}
+
+std::size_t class_size(const std::size_t index) noexcept {
+  return (index + 1) * pooled_frame_allocator::granularity;
+}
+
+class frame_cache {
+  struct free_frame {
+    free_frame *next;
+  };
+
+  struct free_list {
+    free_frame *head{nullptr};
+    std::size_t size{0};
+  };
+
+ public:
+  frame_cache() = default;
+  frame_cache(const frame_cache &) = delete;
+  frame_cache &operator=(const frame_cache &) = delete;
+
+  ~frame_cache() {
+    for (std::size_t i = 0; i < class_count; ++i) {
+      while (auto *frame = lists_[i].head) {
+        lists_[i].head = frame->next;
+        ::operator delete(frame, class_size(i));
+      }
+
+      // Frames freed during the rest of the thread shutdown go to the heap.
+      lists_[i].size = pooled_frame_allocator::max_cached;
+    }
+  }
+
+  void *pop(const std::size_t index) noexcept {
+    auto &list = lists_[index];
+    auto *frame = list.head;
+    if (frame) {
+      list.head = frame->next;
+      --list.size;
+    }
+
+    return frame;
+  }
+
+  bool push(void *ptr, const std::size_t index) noexcept {
+    auto &list = lists_[index];
+    if (list.size == pooled_frame_allocator::max_cached) {
+      return false;
+    }
+
+    list.head = ::new (ptr) free_frame{list.head};
+    ++list.size;
+    return true;
+  }
+
+ private:
+  std::array<free_list, class_count> lists_;
+};
+
+thread_local frame_cache cache;
+
+}  // namespace
+
+void *pooled_frame_allocator::allocate(const std::size_t size) {
+  if (size == 0 || size > max_size) {
+    return ::operator new(size);
+  }
+
+  const auto index = size_class(size);
+  if (auto *ptr = cache.pop(index)) {
+    return ptr;
+  }
+
+  return ::operator new(class_size(index));
+}
+
+void pooled_frame_allocator::deallocate(void *ptr,
+                                        const std::size_t size) noexcept {
+  if (size == 0 || size > max_size) {
+    ::operator delete(ptr, size);
+    return;
+  }
+
+  const auto index = size_class(size);
+  if (!cache.push(ptr, index)) {
+    ::operator delete(ptr, class_size(index));
+  }
+}
+
+}  // namespace ecoro
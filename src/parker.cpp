@@ -0,0 +1,140 @@
+// Copyright 2022 - present, Mikhail Svetkin
+// All rights reserved.
+//
+// For the license information refer to LICENSE
+
+#include "ecoro/detail/parker.hpp"
+
+#include "ecoro/detail/cpu_relax.hpp"
+
+#if defined(__linux__)
+#  include <linux/futex.h>
+#  include <sys/syscall.h>
+#  include <time.h>
+#  include <unistd.h>
+#endif
+
+namespace ecoro::detail {
+
+namespace {
+
+enum : std::uint32_t { empty = 0, notified = 1, parked = 2 };
+
+#if defined(__linux__)
+
+void futex_wait(std::atomic<std::uint32_t> &state, const std::uint32_t expected,
+                const std::chrono::steady_clock::time_point *deadline) {
+  timespec timeout{};
+  timespec *timeout_ptr = nullptr;
+
+  if (deadline) {
+    const auto left = *deadline - std::chrono::steady_clock::now();
+    if (left <= std::chrono::steady_clock::duration::zero()) {
+      return;
+    }
+
+    const auto seconds = std::chrono::duration_cast<std::chrono::seconds>(left);
+    timeout.tv_sec = static_cast<time_t>(seconds.count());
+    timeout.tv_nsec = static_cast<long>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(left - seconds)
+            .count());
+    timeout_ptr = &timeout;
+  }
+
+  syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&state),
+          FUTEX_WAIT_PRIVATE, expected, timeout_ptr, nullptr, 0);
+}
+
+void futex_wake_one(std::atomic<std::uint32_t> &state) {
+  syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&state),
+          FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+}
+
+#endif  // __linux__
+
+}  // namespace
+
+parker::parker(const std::size_t spin_count) noexcept
+    : spin_count_(spin_count) {
+}
+
+void parker::park() noexcept {
+  if (try_park()) {
+    wait(nullptr);
+  }
+}
+
+void parker::park_until(
+    const std::chrono::steady_clock::time_point deadline) noexcept {
+  if (try_park()) {
+    wait(&deadline);
+  }
+}
+
+void parker::unpark() noexcept {
+  if (state_.exchange(notified, std::memory_order_release) != parked) {
+    return;
+  }
+
+#if defined(__linux__)
+  futex_wake_one(state_);
+#else
+  // Taking the lock makes sure the parked thread is either before its
+  // predicate check or already waiting.
+  std::lock_guard lock{mutex_};
+  cv_.notify_one();
+#endif
+}
+
+bool parker::try_park() noexcept {
+  for (std::size_t i = 0; i < spin_count_; ++i) {
+    if (state_.load(std::memory_order_relaxed) == notified) {
+      break;
+    }
+    cpu_relax();
+  }
+
+  auto expected = static_cast<std::uint32_t>(notified);
+  if (state_.compare_exchange_strong(expected, empty,
+                                     std::memory_order_acquire)) {
+    return false;
+  }
+
+  expected = empty;
+  if (!state_.compare_exchange_strong(expected, parked,
+                                      std::memory_order_acquire)) {
+    // unpark() came in between.
+    state_.exchange(empty, std::memory_order_acquire);
+    return false;
+  }
+
+  return true;
+}
+
+void parker::wait(
+    const std::chrono::steady_clock::time_point *deadline) noexcept {
+#if defined(__linux__)
+  while (state_.load(std::memory_order_acquire) == parked) {
+    futex_wait(state_, parked, deadline);
+    if (deadline && std::chrono::steady_clock::now() >= *deadline) {
+      break;
+    }
+  }
+#else
+  std::unique_lock lock{mutex_};
+  auto not_parked = [this] {
+    return state_.load(std::memory_order_acquire) != parked;
+  };
+
+  if (deadline) {
+    cv_.wait_until(lock, *deadline, not_parked);
+  } else {
+    cv_.wait(lock, not_parked);
+  }
+#endif
+
+  // Either notified or timed out, in both cases the state goes back to empty.
+  state_.exchange(empty, std::memory_order_acquire);
+}
+
+}  // namespace ecoro::detail
@@ -14,17 +14,26 @@ scope::scope(scheduler *const scheduler)
 }
 
 std::size_t scope::size() const noexcept {
-  return count_.load(std::memory_order_acquire);
+  return count_.load(std::memory_order_acquire) >> 1;
 }
 
 void scope::on_task_started() {
-  count_.fetch_add(1, std::memory_order_relaxed);
+  count_.fetch_add(2u, std::memory_order_relaxed);
 }
 
 void scope::on_task_finished() {
-  if (count_.fetch_sub(1u, std::memory_order_acq_rel) == 0 && continuation_) {
+  if (count_.fetch_sub(2u, std::memory_order_acq_rel) == 2u) {
     continuation_.resume();
   }
 }
 
+bool scope::try_join() noexcept {
+  return count_.fetch_sub(1u, std::memory_order_acq_rel) != 1u;
+}
+
+void scope::on_joined() noexcept {
+  continuation_ = nullptr;
+  count_.fetch_add(1u, std::memory_order_relaxed);
+}
+
 }  // namespace ecoro
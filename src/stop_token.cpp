@@ -5,48 +5,260 @@
 
 #include "ecoro/stop_token.hpp"
 
+#include "ecoro/detail/cpu_relax.hpp"
+#include "ecoro/scheduler.hpp"
+
+#include <algorithm>
+
 namespace ecoro {
 
 namespace detail::_st {
 
+namespace {
+
+// The lock is held for a few pointer updates only, so spinning is cheaper
+// than parking; yielding keeps a preempted holder from being starved.
+template<typename Predicate>
+void spin_wait(Predicate predicate) noexcept {
+  for (int spins = 0; !predicate(); ++spins) {
+    if (spins < 64) {
+      cpu_relax();
+    } else {
+      std::this_thread::yield();
+    }
+  }
+}
+
+}  // namespace
+
+// Shared by the state and the scheduler, whichever lets go last deletes it.
+// That way neither a timer that fires while the state dies nor a state that
+// dies while the timer is queued touches freed memory.
+struct deadline_timer : timer_operation {
+  deadline_timer(ecoro::scheduler &scheduler,
+                 std::weak_ptr<stop_state> state) noexcept
+      : scheduler_(scheduler),
+        state_(std::move(state)) {
+    execute_ = &fire;
+  }
+
+  static void fire(scheduler_operation *that) noexcept {
+    auto *timer = static_cast<deadline_timer *>(that);
+    if (auto state = timer->state_.lock()) {
+      state->lock();
+      const bool detached = state->timer_ == timer;
+      if (detached) {
+        state->timer_ = nullptr;
+      }
+      state->unlock();
+
+      state->request_stop();
+      if (detached) {
+        timer->release();
+      }
+    }
+
+    timer->release();
+  }
+
+  // Called by the state once it no longer points to the timer.
+  void cancel() noexcept {
+    if (scheduler_.cancel_timer(*this)) {
+      release();
+    }
+    release();
+  }
+
+  void release() noexcept {
+    if (references_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      delete this;
+    }
+  }
+
+  ecoro::scheduler &scheduler_;
+  std::weak_ptr<stop_state> state_;
+  std::atomic<int> references_{2};
+};
+
 void stop_callback_base::execute() noexcept {
   execute_(this);
 }
 
-void stop_state::request_stop() noexcept {
-  std::lock_guard lock{mutex_};
+void stop_state::parent_link::execute(stop_callback_base *that) noexcept {
+  auto &state = *static_cast<parent_link *>(that)->state_;
+  // A callback of the linked state may drop the last reference to it, the
+  // state has to outlive its own request_stop(). The link is added only
+  // once the state is owned by a shared_ptr, so the lock fails only while
+  // the state is being destroyed, and then the destructor waits for it
+  // before it takes the timer.
+  const auto keep_alive = state.weak_from_this().lock();
+  state.request_stop();
+}
 
-  if (stop_requested_)
+stop_state::~stop_state() {
+  // Unlinked first, remove_callback() waits for a link that a stop of the
+  // parent runs meanwhile. Its request_stop() takes the timer as well.
+  if (parent_) {
+    parent_->remove_callback(parent_link_);
+  }
+
+  lock();
+  auto *timer = std::exchange(timer_, nullptr);
+  unlock();
+
+  if (timer) {
+    timer->cancel();
+  }
+}
+
+void stop_state::request_stop() noexcept {
+  if (!try_lock(stop_requested_bit, stop_requested_bit | locked_bit)) {
     return;
+  }
 
-  stop_requested_ = true;
+  requester_ = std::this_thread::get_id();
+
+  // The deadline is of no use anymore, its timer slot is freed right away.
+  if (auto *timer = std::exchange(timer_, nullptr)) {
+    unlock();
+    timer->cancel();
+    lock();
+  }
 
-  for (auto &callback : callbacks_) {
+  // Every callback is unlinked before it runs and the lock is dropped while
+  // it runs, so other callbacks may deregister meanwhile.
+  while (!callbacks_.empty()) {
+    auto &callback = *callbacks_.begin();
+    callbacks_.erase(callbacks_.begin());
+    unlock();
+
+    bool destroyed = false;
+    callback.destroyed_ = &destroyed;
     callback.execute();
+    if (!destroyed) {
+      callback.destroyed_ = nullptr;
+      callback.executed_.store(true, std::memory_order_release);
+    }
+
+    lock();
   }
 
-  callbacks_.clear();
+  unlock();
 }
 
 bool stop_state::stop_requested() const noexcept {
-  return stop_requested_;
+  return value_.load(std::memory_order_acquire) & stop_requested_bit;
 }
 
 bool stop_state::try_add_callback(stop_callback_base &callback) noexcept {
-  std::lock_guard lock{mutex_};
-
-  if (stop_requested_) {
+  if (!try_lock(stop_requested_bit, locked_bit)) {
     callback.execute();
     return false;
   }
 
   callbacks_.push_back(callback);
+  unlock();
   return true;
 }
 
 void stop_state::remove_callback(stop_callback_base &callback) noexcept {
-  std::lock_guard lock{mutex_};
-  callbacks_.erase(callbacks_.iterator_to(callback));
+  lock();
+  if (callback.next) {
+    callbacks_.erase(callbacks_.iterator_to(callback));
+    unlock();
+    return;
+  }
+  unlock();
+
+  // request_stop() has taken the callback. From inside the callback itself
+  // waiting would deadlock, it only has to learn that it is gone.
+  if (requester_ == std::this_thread::get_id()) {
+    if (callback.destroyed_) {
+      *callback.destroyed_ = true;
+    }
+    return;
+  }
+
+  // Otherwise it runs on another thread and has to finish first.
+  spin_wait([&callback] {
+    return callback.executed_.load(std::memory_order_acquire);
+  });
+}
+
+void stop_state::request_stop_at(
+    scheduler &scheduler, const std::chrono::steady_clock::time_point deadline) {
+  auto *timer = new deadline_timer{scheduler, weak_from_this()};
+  timer->deadline = deadline;
+
+  const auto ticks = deadline.time_since_epoch().count();
+  lock();
+  if ((value_.load(std::memory_order_relaxed) & stop_requested_bit) ||
+      ticks >= deadline_.load(std::memory_order_relaxed)) {
+    unlock();
+    delete timer;
+    return;
+  }
+
+  deadline_.store(ticks, std::memory_order_relaxed);
+  auto *previous = std::exchange(timer_, timer);
+  // Added under the lock, so that a racing replacement only ever cancels a
+  // timer that is already in the scheduler.
+  scheduler.add_timer(*timer);
+  unlock();
+
+  if (previous) {
+    previous->cancel();
+  }
+}
+
+std::optional<std::chrono::steady_clock::time_point> stop_state::deadline()
+    const noexcept {
+  using clock = std::chrono::steady_clock;
+
+  auto ticks = deadline_.load(std::memory_order_relaxed);
+  if (parent_) {
+    if (const auto parent_deadline = parent_->deadline()) {
+      ticks = std::min(ticks, parent_deadline->time_since_epoch().count());
+    }
+  }
+
+  if (ticks == clock::duration::max().count()) {
+    return std::nullopt;
+  }
+
+  return clock::time_point{clock::duration{ticks}};
+}
+
+void stop_state::lock() noexcept {
+  try_lock(0, locked_bit);
+}
+
+bool stop_state::try_lock(const std::uint32_t mask_bits,
+                          const std::uint32_t new_bits) noexcept {
+  auto current = value_.load(std::memory_order_acquire);
+  for (;;) {
+    if (current & mask_bits) {
+      return false;
+    }
+
+    if (current & locked_bit) {
+      spin_wait([this, &current] {
+        current = value_.load(std::memory_order_acquire);
+        return !(current & locked_bit);
+      });
+      continue;
+    }
+
+    if (value_.compare_exchange_weak(current, current | new_bits,
+                                     std::memory_order_acquire,
+                                     std::memory_order_acquire)) {
+      return true;
+    }
+  }
+}
+
+void stop_state::unlock() noexcept {
+  value_.fetch_and(~locked_bit, std::memory_order_release);
 }
 
 }  // namespace detail::_st
@@ -67,6 +279,14 @@ bool stop_token::stop_possible() const noexcept {
   return !state_.expired();
 }
 
+std::optional<std::chrono::steady_clock::time_point> stop_token::deadline()
+    const noexcept {
+  if (auto state = state_.lock()) {
+    return state->deadline();
+  }
+  return std::nullopt;
+}
+
 
 stop_source::stop_source()
     : state_(std::make_shared<detail::_st::stop_state>()) {
@@ -75,6 +295,18 @@ stop_source::stop_source()
 stop_source::stop_source(nostopstate_t /*nss*/) noexcept {
 }
 
+stop_source::stop_source(const stop_token &parent)
+    : state_(std::make_shared<detail::_st::stop_state>()) {
+  // Linked only now that state_ owns the state, the link may run on another
+  // thread at once and has to be able to lock it. A parent that is already
+  // stopped runs the link right away and is not kept.
+  if (auto parent_state = parent.state_.lock()) {
+    if (parent_state->try_add_callback(state_->parent_link_)) {
+      state_->parent_ = std::move(parent_state);
+    }
+  }
+}
+
 stop_token stop_source::get_token() const noexcept {
   return stop_token(state_);
 }
@@ -84,6 +316,20 @@ void stop_source::request_stop() noexcept {
     state_->request_stop();
 }
 
+void stop_source::request_stop_at(
+    scheduler &scheduler, const std::chrono::steady_clock::time_point deadline) {
+  if (state_)
+    state_->request_stop_at(scheduler, deadline);
+}
+
+std::optional<std::chrono::steady_clock::time_point> stop_source::deadline()
+    const noexcept {
+  if (state_)
+    return state_->deadline();
+
+  return std::nullopt;
+}
+
 bool stop_source::stop_requested() const noexcept {
   if (state_)
     return state_->stop_requested();
@@ -0,0 +1,378 @@
+// Copyright 2022 - present, Mikhail Svetkin
+// All rights reserved.
+//
+// For the license information refer to LICENSE
+
+#include "ecoro/thread_pool.hpp"
+
+#include "ecoro/detail/work_stealing_deque.hpp"
+
+#include <algorithm>
+#include <optional>
+
+namespace ecoro {
+
+namespace {
+
+// Every N-th tick a worker looks into the injection queue before its own
+// queue, otherwise a busy worker could starve the outside world.
+constexpr std::uint32_t global_queue_interval = 61;
+
+// How many times in a row a worker may run the LIFO slot before it has to
+// take the rest of its queue into account.
+constexpr std::uint32_t lifo_slot_budget = 3;
+
+std::int64_t to_ticks(const std::chrono::steady_clock::time_point tp) noexcept {
+  return tp.time_since_epoch().count();
+}
+
+}  // namespace
+
+struct thread_pool::worker {
+  worker(thread_pool &pool, const std::size_t index,
+         const std::size_t spin_count)
+      : pool_(pool),
+        index_(index),
+        random_(static_cast<std::uint32_t>(index) * 2654435761u + 1u),
+        parker_(spin_count) {}
+
+  std::uint32_t next_random() noexcept {
+    // xorshift32
+    random_ ^= random_ << 13;
+    random_ ^= random_ >> 17;
+    random_ ^= random_ << 5;
+    return random_;
+  }
+
+  thread_pool &pool_;
+  std::size_t index_;
+  detail::work_stealing_deque<detail::scheduler_operation *> queue_;
+  detail::scheduler_operation *lifo_slot_{nullptr};
+  std::uint32_t lifo_runs_{0};
+  std::uint32_t tick_{0};
+  std::uint32_t random_;
+  detail::parker parker_;
+  std::thread thread_;
+};
+
+thread_local thread_pool::worker *thread_pool::current_worker_{nullptr};
+
+thread_pool::thread_pool(std::size_t thread_count,
+                         const std::size_t spin_count) {
+  thread_count = std::max<std::size_t>(thread_count, 1);
+
+  workers_.reserve(thread_count);
+  for (std::size_t i = 0; i < thread_count; ++i) {
+    workers_.push_back(std::make_unique<worker>(*this, i, spin_count));
+  }
+
+  // Every worker may be idle at once, a worker going to sleep then never
+  // allocates.
+  idle_workers_.reserve(thread_count);
+
+  for (auto &w : workers_) {
+    w->thread_ = std::thread([this, &self = *w] { run(self); });
+  }
+}
+
+thread_pool::~thread_pool() {
+  {
+    std::lock_guard lock{mutex_};
+    stopping_.store(true, std::memory_order_relaxed);
+  }
+
+  for (auto &w : workers_) {
+    w->parker_.unpark();
+  }
+
+  for (auto &w : workers_) {
+    w->thread_.join();
+  }
+}
+
+std::size_t thread_pool::thread_count() const noexcept {
+  return workers_.size();
+}
+
+void thread_pool::enqueue(detail::scheduler_operation *operation) noexcept {
+  if (auto *self = current_worker_; self && &self->pool_ == this) {
+    // The freshly scheduled continuation is the most likely to have its data
+    // in cache, so it runs next; the one it displaces becomes stealable.
+    if (auto *previous = std::exchange(self->lifo_slot_, operation)) {
+      self->queue_.push(previous);
+      notify_one();
+    }
+    return;
+  }
+
+  inject(operation);
+}
+
+void thread_pool::yield(detail::scheduler_operation *operation) noexcept {
+  // The global queue is FIFO and shared, so the yielding coroutine runs after
+  // the local work and may move to a less busy worker.
+  inject(operation);
+}
+
+void thread_pool::inject(detail::scheduler_operation *operation) noexcept {
+  worker *idle = nullptr;
+  {
+    std::lock_guard lock{mutex_};
+    injection_queue_.push_back(operation);
+    has_injected_.store(true, std::memory_order_relaxed);
+    idle = pop_idle_worker();
+  }
+
+  if (idle) {
+    idle->parker_.unpark();
+  }
+}
+
+void thread_pool::add_timer(detail::timer_operation &operation) noexcept {
+  worker *to_wake = nullptr;
+  {
+    std::unique_lock lock{mutex_};
+    if (operation.cancelled()) {
+      // Cancelled before it was added, resume it right away.
+      lock.unlock();
+      enqueue(&operation);
+      return;
+    }
+
+    operation.state_ = detail::timer_operation::state::added;
+    timers_.add(operation);
+    update_next_timer();
+
+    if (!timer_keeper_) {
+      // An idle worker becomes the one that waits for the deadline.
+      to_wake = pop_idle_worker();
+    } else if (operation.deadline < timer_keeper_deadline_) {
+      to_wake = timer_keeper_;
+    }
+  }
+
+  if (to_wake) {
+    to_wake->parker_.unpark();
+  }
+}
+
+bool thread_pool::cancel_timer(detail::timer_operation &operation) noexcept {
+  std::lock_guard lock{mutex_};
+  if (operation.state_ == detail::timer_operation::state::idle) {
+    operation.state_ = detail::timer_operation::state::cancelled;
+    return false;
+  }
+
+  if (!timers_.remove(operation)) {
+    return false;
+  }
+
+  operation.state_ = detail::timer_operation::state::cancelled;
+  // The timer keeper may keep sleeping until the old deadline, it just
+  // finds nothing to do.
+  update_next_timer();
+  return true;
+}
+
+void thread_pool::update_next_timer() noexcept {
+  const auto next = timers_.next_deadline();
+  next_timer_.store(next ? to_ticks(*next) : INT64_MAX,
+                    std::memory_order_relaxed);
+}
+
+void thread_pool::run(worker &self) {
+  current_worker_ = &self;
+
+  while (!stopping_.load(std::memory_order_relaxed)) {
+    if (auto *operation = next_operation(self)) {
+      operation->execute();
+      continue;
+    }
+
+    wait_for_work(self);
+  }
+
+  current_worker_ = nullptr;
+}
+
+detail::scheduler_operation *thread_pool::next_operation(worker &self) {
+  ++self.tick_;
+
+  if (self.tick_ % global_queue_interval == 0) {
+    if (auto *operation = pop_injected()) {
+      return operation;
+    }
+  }
+
+  if (self.lifo_slot_) {
+    if (self.lifo_runs_ < lifo_slot_budget) {
+      ++self.lifo_runs_;
+      return std::exchange(self.lifo_slot_, nullptr);
+    }
+
+    self.queue_.push(std::exchange(self.lifo_slot_, nullptr));
+  }
+  self.lifo_runs_ = 0;
+
+  if (auto *operation = self.queue_.pop()) {
+    return operation;
+  }
+
+  if (process_timers(self)) {
+    return self.queue_.pop();
+  }
+
+  if (auto *operation = pop_injected()) {
+    return operation;
+  }
+
+  return steal(self);
+}
+
+detail::scheduler_operation *thread_pool::pop_injected() noexcept {
+  if (!has_injected_.load(std::memory_order_relaxed)) {
+    return nullptr;
+  }
+
+  std::lock_guard lock{mutex_};
+  auto *operation = injection_queue_.pop_front();
+  has_injected_.store(!injection_queue_.empty(), std::memory_order_relaxed);
+  return operation;
+}
+
+detail::scheduler_operation *thread_pool::steal(worker &self) noexcept {
+  const auto count = workers_.size();
+  if (count < 2) {
+    return nullptr;
+  }
+
+  const auto start = self.next_random() % count;
+  for (std::size_t i = 0; i < count; ++i) {
+    auto &victim = *workers_[(start + i) % count];
+    if (&victim == &self) {
+      continue;
+    }
+
+    if (auto *operation = victim.queue_.steal()) {
+      return operation;
+    }
+  }
+
+  return nullptr;
+}
+
+bool thread_pool::process_timers(worker &self) {
+  const auto now = std::chrono::steady_clock::now();
+  if (next_timer_.load(std::memory_order_relaxed) > to_ticks(now)) {
+    return false;
+  }
+
+  std::unique_lock lock{mutex_, std::try_to_lock};
+  if (!lock) {
+    return false;
+  }
+
+  const auto expired = timers_.advance(now, [&self](timer_node &node) {
+    self.queue_.push(static_cast<detail::timer_operation *>(&node));
+  });
+  update_next_timer();
+  lock.unlock();
+
+  if (expired > 1) {
+    notify_one();
+  }
+
+  return expired > 0;
+}
+
+bool thread_pool::has_pending_work() const noexcept {
+  if (!injection_queue_.empty()) {
+    return true;
+  }
+
+  if (next_timer_.load(std::memory_order_relaxed) <=
+      to_ticks(std::chrono::steady_clock::now())) {
+    return true;
+  }
+
+  return std::any_of(workers_.begin(), workers_.end(),
+                     [](const auto &w) { return !w->queue_.empty(); });
+}
+
+void thread_pool::wait_for_work(worker &self) {
+  std::unique_lock lock{mutex_};
+  if (stopping_.load(std::memory_order_relaxed)) {
+    return;
+  }
+
+  idle_workers_.push_back(&self);
+  sleepers_.store(idle_workers_.size(), std::memory_order_seq_cst);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+
+  if (has_pending_work()) {
+    remove_idle_worker(self);
+    return;
+  }
+
+  // Only one sleeping worker waits for the next deadline, the others sleep
+  // until new work arrives.
+  std::optional<std::chrono::steady_clock::time_point> deadline;
+  if (!timer_keeper_) {
+    deadline = timers_.next_deadline();
+    if (deadline) {
+      timer_keeper_ = &self;
+      timer_keeper_deadline_ = *deadline;
+    }
+  }
+  lock.unlock();
+
+  if (deadline) {
+    self.parker_.park_until(*deadline);
+  } else {
+    self.parker_.park();
+  }
+
+  lock.lock();
+  if (timer_keeper_ == &self) {
+    timer_keeper_ = nullptr;
+  }
+  remove_idle_worker(self);
+}
+
+void thread_pool::notify_one() noexcept {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (sleepers_.load(std::memory_order_seq_cst) == 0) {
+    return;
+  }
+
+  worker *idle = nullptr;
+  {
+    std::lock_guard lock{mutex_};
+    idle = pop_idle_worker();
+  }
+
+  if (idle) {
+    idle->parker_.unpark();
+  }
+}
+
+thread_pool::worker *thread_pool::pop_idle_worker() noexcept {
+  if (idle_workers_.empty()) {
+    return nullptr;
+  }
+
+  auto *idle = idle_workers_.back();
+  idle_workers_.pop_back();
+  sleepers_.store(idle_workers_.size(), std::memory_order_relaxed);
+  return idle;
+}
+
+void thread_pool::remove_idle_worker(worker &self) noexcept {
+  auto it = std::find(idle_workers_.begin(), idle_workers_.end(), &self);
+  if (it != idle_workers_.end()) {
+    idle_workers_.erase(it);
+    sleepers_.store(idle_workers_.size(), std::memory_order_relaxed);
+  }
+}
+
+}  // namespace ecoro
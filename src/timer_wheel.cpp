@@ -0,0 +1,205 @@
+// Copyright 2022 - present, Mikhail Svetkin
+// All rights reserved.
+//
+// For the license information refer to LICENSE
+
+#include "ecoro/timer_wheel.hpp"
+
+#include <bit>
+
+namespace ecoro {
+
+namespace {
+
+constexpr std::uint64_t slot_mask = timer_wheel::slot_count - 1;
+
+// The whole wheel covers 2^36 ticks, the timers beyond that are parked in
+// the last level and cascaded again once their slot comes up.
+constexpr std::size_t wheel_bits =
+    timer_wheel::slot_bits * timer_wheel::level_count;
+constexpr std::uint64_t max_ticks = (std::uint64_t{1} << wheel_bits) - 1;
+
+// The level is defined by the most significant bit in which the deadline
+// differs from the current time.
+std::size_t level_for(const std::uint64_t elapsed,
+                      const std::uint64_t when) noexcept {
+  auto masked = (elapsed ^ when) | slot_mask;
+  if (masked >= max_ticks) {
+    masked = max_ticks - 1;
+  }
+
+  const auto significant = 63 - std::countl_zero(masked);
+  return static_cast<std::size_t>(significant) / timer_wheel::slot_bits;
+}
+
+std::uint64_t slot_range(const std::size_t level) noexcept {
+  return std::uint64_t{1} << (level * timer_wheel::slot_bits);
+}
+
+std::uint64_t level_range(const std::size_t level) noexcept {
+  return std::uint64_t{1} << ((level + 1) * timer_wheel::slot_bits);
+}
+
+}  // namespace
+
+timer_wheel::timer_wheel(const clock::duration resolution,
+                         const clock::time_point start) noexcept
+    : resolution_(resolution), start_(start) {
+}
+
+void timer_wheel::add(timer_node &node) noexcept {
+  node.when_ = to_ticks(node.deadline, true);
+  insert(node);
+  ++size_;
+}
+
+bool timer_wheel::remove(timer_node &node) noexcept {
+  if (!node.pending()) {
+    return false;
+  }
+
+  if (node.level_ == level_count) {
+    expired_.erase(slot_list::iterator_to(node));
+  } else {
+    auto &lvl = levels_[node.level_];
+    auto &slot = lvl.slots[node.slot_];
+    slot.erase(slot_list::iterator_to(node));
+    if (slot.empty()) {
+      lvl.occupied &= ~(std::uint64_t{1} << node.slot_);
+    }
+  }
+
+  --size_;
+  return true;
+}
+
+std::optional<timer_wheel::clock::time_point> timer_wheel::next_deadline()
+    const noexcept {
+  if (!expired_.empty()) {
+    return to_time_point(elapsed_);
+  }
+
+  if (auto exp = next_expiration()) {
+    return to_time_point(exp->deadline);
+  }
+
+  return std::nullopt;
+}
+
+bool timer_wheel::empty() const noexcept {
+  return size_ == 0;
+}
+
+std::size_t timer_wheel::size() const noexcept {
+  return size_;
+}
+
+timer_node *timer_wheel::poll(const clock::time_point now) noexcept {
+  const auto target = to_ticks(now, false);
+
+  while (expired_.empty()) {
+    const auto exp = next_expiration();
+    if (!exp || exp->deadline > target) {
+      if (target > elapsed_) {
+        elapsed_ = target;
+      }
+      return nullptr;
+    }
+
+    process(*exp);
+  }
+
+  auto &node = *expired_.begin();
+  expired_.erase(expired_.begin());
+  --size_;
+  return &node;
+}
+
+void timer_wheel::insert(timer_node &node) noexcept {
+  if (node.when_ <= elapsed_) {
+    node.level_ = level_count;
+    expired_.push_back(node);
+    return;
+  }
+
+  const auto level = level_for(elapsed_, node.when_);
+  const auto slot = (node.when_ >> (level * slot_bits)) & slot_mask;
+
+  node.level_ = static_cast<std::uint8_t>(level);
+  node.slot_ = static_cast<std::uint8_t>(slot);
+
+  levels_[level].slots[slot].push_back(node);
+  levels_[level].occupied |= std::uint64_t{1} << slot;
+}
+
+std::optional<timer_wheel::expiration> timer_wheel::next_expiration()
+    const noexcept {
+  for (std::size_t level = 0; level < level_count; ++level) {
+    const auto occupied = levels_[level].occupied;
+    if (!occupied) {
+      continue;
+    }
+
+    // The first occupied slot starting from the current one.
+    const auto now_slot = (elapsed_ / slot_range(level)) & slot_mask;
+    const auto rotated = std::rotr(occupied, static_cast<int>(now_slot));
+    const auto slot = (now_slot + std::countr_zero(rotated)) & slot_mask;
+
+    const auto level_start = elapsed_ & ~(level_range(level) - 1);
+    auto deadline = level_start + slot * slot_range(level);
+    if (deadline <= elapsed_ && level > 0) {
+      // The slot belongs to the next rotation of this level.
+      deadline += level_range(level);
+    }
+
+    return expiration{level, slot, deadline};
+  }
+
+  return std::nullopt;
+}
+
+void timer_wheel::process(const expiration &exp) noexcept {
+  auto &lvl = levels_[exp.level];
+  auto &slot = lvl.slots[exp.slot];
+  lvl.occupied &= ~(std::uint64_t{1} << exp.slot);
+
+  elapsed_ = exp.deadline;
+
+  // Timers of the higher levels move closer to the bottom or expire. A timer
+  // beyond the wheel range can land in the very same slot again, so the slot
+  // is drained first.
+  slot_list pending;
+  while (!slot.empty()) {
+    auto &node = *slot.begin();
+    slot.erase(slot.begin());
+    pending.push_back(node);
+  }
+
+  while (!pending.empty()) {
+    auto &node = *pending.begin();
+    pending.erase(pending.begin());
+    insert(node);
+  }
+}
+
+std::uint64_t timer_wheel::to_ticks(const clock::time_point tp,
+                                    const bool round_up) const noexcept {
+  if (tp <= start_) {
+    return 0;
+  }
+
+  const auto since_start = tp - start_;
+  auto ticks = static_cast<std::uint64_t>(since_start / resolution_);
+  if (round_up && since_start % resolution_ != clock::duration::zero()) {
+    ++ticks;
+  }
+
+  return ticks;
+}
+
+timer_wheel::clock::time_point timer_wheel::to_time_point(
+    const std::uint64_t ticks) const noexcept {
+  return start_ + resolution_ * ticks;
+}
+
+}  // namespace ecoro
@@ -0,0 +1,63 @@
+// Copyright 2022 - present, Mikhail Svetkin
+// All rights reserved.
+//
+// For the license information refer to LICENSE
+
+#include "ecoro/detail/parker.hpp"
+
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <thread>
+
+using namespace std::chrono_literals;
+
+TEST(parker, unpark_before_park) {
+  ecoro::detail::parker parker;
+  parker.unpark();
+  parker.park();
+  SUCCEED();
+}
+
+TEST(parker, park_until_times_out) {
+  ecoro::detail::parker parker{0};
+  const auto start = std::chrono::steady_clock::now();
+  parker.park_until(start + 20ms);
+  EXPECT_GE(std::chrono::steady_clock::now() - start, 20ms);
+}
+
+TEST(parker, unpark_from_another_thread) {
+  ecoro::detail::parker parker{0};
+  std::atomic<bool> woken{false};
+
+  std::thread thread{[&] {
+    parker.park();
+    woken = true;
+  }};
+
+  std::this_thread::sleep_for(10ms);
+  parker.unpark();
+  thread.join();
+  EXPECT_TRUE(woken);
+}
+
+TEST(parker, ping_pong) {
+  ecoro::detail::parker ping;
+  ecoro::detail::parker pong;
+  constexpr int rounds = 10000;
+
+  std::thread thread{[&] {
+    for (int i = 0; i < rounds; ++i) {
+      ping.park();
+      pong.unpark();
+    }
+  }};
+
+  for (int i = 0; i < rounds; ++i) {
+    ping.unpark();
+    pong.park();
+  }
+
+  thread.join();
+  SUCCEED();
+}
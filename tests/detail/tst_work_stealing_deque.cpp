@@ -0,0 +1,97 @@
+// Copyright 2022 - present, Mikhail Svetkin
+// All rights reserved.
+//
+// For the license information refer to LICENSE
+
+#include "ecoro/detail/work_stealing_deque.hpp"
+
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+TEST(work_stealing_deque, initial_state) {
+  ecoro::detail::work_stealing_deque<int *> deque;
+  EXPECT_TRUE(deque.empty());
+  EXPECT_EQ(deque.size(), 0);
+  EXPECT_EQ(deque.pop(), nullptr);
+  EXPECT_EQ(deque.steal(), nullptr);
+}
+
+TEST(work_stealing_deque, pop_is_lifo_steal_is_fifo) {
+  ecoro::detail::work_stealing_deque<int *> deque;
+  int values[3] = {1, 2, 3};
+
+  for (auto &value : values) {
+    deque.push(&value);
+  }
+  EXPECT_EQ(deque.size(), 3);
+
+  EXPECT_EQ(deque.pop(), &values[2]);
+  EXPECT_EQ(deque.steal(), &values[0]);
+  EXPECT_EQ(deque.pop(), &values[1]);
+  EXPECT_TRUE(deque.empty());
+}
+
+TEST(work_stealing_deque, grow) {
+  ecoro::detail::work_stealing_deque<int *> deque{2};
+  std::vector<int> values(100);
+
+  for (auto &value : values) {
+    deque.push(&value);
+  }
+  EXPECT_EQ(deque.size(), values.size());
+
+  for (auto it = values.rbegin(); it != values.rend(); ++it) {
+    EXPECT_EQ(deque.pop(), &*it);
+  }
+  EXPECT_TRUE(deque.empty());
+}
+
+TEST(work_stealing_deque, concurrent_steal) {
+  constexpr int count = 100'000;
+  std::vector<int> values(count);
+  std::vector<std::atomic<int>> seen(count);
+
+  ecoro::detail::work_stealing_deque<int *> deque{8};
+  std::atomic<int> taken{0};
+
+  auto consume = [&](int *value) {
+    seen[value - values.data()].fetch_add(1, std::memory_order_relaxed);
+    taken.fetch_add(1, std::memory_order_relaxed);
+  };
+
+  std::vector<std::thread> thieves;
+  for (int i = 0; i < 3; ++i) {
+    thieves.emplace_back([&] {
+      while (taken.load(std::memory_order_relaxed) < count) {
+        if (auto *value = deque.steal()) {
+          consume(value);
+        }
+      }
+    });
+  }
+
+  for (int i = 0; i < count; ++i) {
+    deque.push(&values[i]);
+    if (i % 3 == 0) {
+      if (auto *value = deque.pop()) {
+        consume(value);
+      }
+    }
+  }
+
+  while (auto *value = deque.pop()) {
+    consume(value);
+  }
+
+  for (auto &thief : thieves) {
+    thief.join();
+  }
+
+  EXPECT_EQ(taken.load(), count);
+  for (auto &s : seen) {
+    EXPECT_EQ(s.load(), 1);
+  }
+}
@@ -0,0 +1,93 @@
+// Copyright 2022 - present, Mikhail Svetkin
+// All rights reserved.
+//
+// For the license information refer to LICENSE
+
+#ifndef ECORO_TESTS_HELPERS_MANUAL_SCHEDULER_HPP
+#define ECORO_TESTS_HELPERS_MANUAL_SCHEDULER_HPP
+
+#include "ecoro/detail/scheduler_operation.hpp"
+#include "ecoro/scheduler.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+namespace ecoro::helpers {
+
+// Runs queued work and fires timers only when the test says so. Timers
+// fire in deadline order regardless of the clock, so tests of timed
+// combinators do not depend on how fast the machine is. Single-threaded.
+class manual_scheduler final : public scheduler {
+  using state = detail::timer_operation::state;
+
+ public:
+  void enqueue(detail::scheduler_operation *operation) noexcept override {
+    ready_.push_back(operation);
+  }
+
+  void add_timer(detail::timer_operation &operation) noexcept override {
+    if (operation.cancelled()) {
+      enqueue(&operation);
+      return;
+    }
+
+    operation.state_ = state::added;
+    timers_.push_back(&operation);
+  }
+
+  bool cancel_timer(detail::timer_operation &operation) noexcept override {
+    if (operation.state_ == state::idle) {
+      operation.state_ = state::cancelled;
+      return false;
+    }
+
+    const auto it = std::find(timers_.begin(), timers_.end(), &operation);
+    if (it == timers_.end()) {
+      return false;
+    }
+
+    timers_.erase(it);
+    operation.state_ = state::cancelled;
+    return true;
+  }
+
+  // Runs the queued work, including the work queued meanwhile.
+  void run() {
+    while (auto *operation = ready_.pop_front()) {
+      operation->execute();
+    }
+  }
+
+  // Fires the timer with the earliest deadline and runs what it queued.
+  // Returns false if there is no pending timer.
+  bool fire_next_timer() {
+    if (timers_.empty()) {
+      return false;
+    }
+
+    const auto it = std::min_element(
+        timers_.begin(), timers_.end(),
+        [](const auto *lhs, const auto *rhs) {
+          return lhs->deadline < rhs->deadline;
+        });
+    auto *operation = *it;
+    timers_.erase(it);
+
+    enqueue(operation);
+    run();
+    return true;
+  }
+
+  std::size_t pending_timers() const noexcept {
+    return timers_.size();
+  }
+
+ private:
+  detail::operation_queue ready_;
+  std::vector<detail::timer_operation *> timers_;
+};
+
+}  // namespace ecoro::helpers
+
+#endif  // ECORO_TESTS_HELPERS_MANUAL_SCHEDULER_HPP
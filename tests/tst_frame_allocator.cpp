@@ -0,0 +1,181 @@
+// Copyright 2022 - present, Mikhail Svetkin
+// All rights reserved.
+//
+// For the license information refer to LICENSE
+
+#include "ecoro/config.hpp"
+#include "ecoro/frame_allocator.hpp"
+#include "ecoro/sync_wait.hpp"
+#include "ecoro/task.hpp"
+
+#include "gtest/gtest.h"
+
+#include <memory>
+#include <memory_resource>
+#include <thread>
+
+namespace {
+
+template<typename T>
+struct counting_allocator {
+  using value_type = T;
+
+  explicit counting_allocator(int *live) noexcept
+      : live_(live) {}
+
+  template<typename U>
+  counting_allocator(const counting_allocator<U> &other) noexcept
+      : live_(other.live_) {}
+
+  T *allocate(const std::size_t n) {
+    ++*live_;
+    return std::allocator<T>{}.allocate(n);
+  }
+
+  void deallocate(T *ptr, const std::size_t n) noexcept {
+    --*live_;
+    std::allocator<T>{}.deallocate(ptr, n);
+  }
+
+  int *live_;
+};
+
+ECORO_ALLOCATOR_ARG_COROUTINE_BEGIN
+
+ecoro::task<int> add(std::allocator_arg_t, counting_allocator<char>, int a,
+                     int b) {
+  co_return a + b;
+}
+
+struct calculator {
+  ecoro::task<int> twice(std::allocator_arg_t, counting_allocator<char>,
+                         int value) const {
+    co_return value * 2;
+  }
+};
+
+ECORO_ALLOCATOR_ARG_COROUTINE_END
+
+}  // namespace
+
+TEST(frame_allocator, reuses_freed_frame) {
+  using allocator = ecoro::pooled_frame_allocator;
+
+  void *first = allocator::allocate(100);
+  allocator::deallocate(first, 100);
+
+  void *second = allocator::allocate(120);
+  EXPECT_EQ(second, first);
+  allocator::deallocate(second, 120);
+}
+
+TEST(frame_allocator, size_classes_are_segregated) {
+  using allocator = ecoro::pooled_frame_allocator;
+
+  void *small = allocator::allocate(32);
+  allocator::deallocate(small, 32);
+
+  void *large = allocator::allocate(allocator::granularity + 1);
+  EXPECT_NE(large, small);
+  allocator::deallocate(large, allocator::granularity + 1);
+}
+
+TEST(frame_allocator, large_frames_bypass_pool) {
+  using allocator = ecoro::pooled_frame_allocator;
+
+  void *ptr = allocator::allocate(allocator::max_size + 1);
+  EXPECT_NE(ptr, nullptr);
+  allocator::deallocate(ptr, allocator::max_size + 1);
+}
+
+TEST(frame_allocator, free_on_another_thread) {
+  using allocator = ecoro::pooled_frame_allocator;
+
+  void *ptr = allocator::allocate(200);
+  std::thread{[ptr] { allocator::deallocate(ptr, 200); }}.join();
+
+  void *other = allocator::allocate(200);
+  EXPECT_NE(other, nullptr);
+  allocator::deallocate(other, 200);
+}
+
+TEST(frame_allocator, task_frames_are_reused) {
+  auto make_task = []() -> ecoro::task<int> { co_return 42; };
+
+  void *first = nullptr;
+  {
+    auto task = make_task();
+    first = task.handle().address();
+    EXPECT_EQ(ecoro::sync_wait(task), 42);
+  }
+
+  auto task = make_task();
+  EXPECT_EQ(task.handle().address(), first);
+  EXPECT_EQ(ecoro::sync_wait(task), 42);
+}
+
+TEST(frame_allocator, allocator_arg) {
+  int live = 0;
+  {
+    auto task = add(std::allocator_arg, counting_allocator<char>{&live}, 1, 2);
+    EXPECT_EQ(live, 1);
+    EXPECT_EQ(ecoro::sync_wait(task), 3);
+  }
+
+  EXPECT_EQ(live, 0);
+}
+
+TEST(frame_allocator, allocator_arg_delete) {
+  using promise = ecoro::task<int>::promise_type;
+
+  int live = 0;
+  const counting_allocator<char> alloc{&live};
+  const calculator calc;
+
+  void *frame = promise::operator new(64, std::allocator_arg, alloc, 1);
+  EXPECT_EQ(live, 1);
+  promise::operator delete(frame, 64, std::allocator_arg, alloc, 1);
+  EXPECT_EQ(live, 0);
+
+  frame = promise::operator new(64, calc, std::allocator_arg, alloc);
+  EXPECT_EQ(live, 1);
+  promise::operator delete(frame, 64, calc, std::allocator_arg, alloc);
+  EXPECT_EQ(live, 0);
+}
+
+TEST(frame_allocator, allocator_arg_member_function) {
+  int live = 0;
+  {
+    calculator calc;
+    auto task = calc.twice(std::allocator_arg, counting_allocator<char>{&live},
+                           21);
+    EXPECT_EQ(live, 1);
+    EXPECT_EQ(ecoro::sync_wait(task), 42);
+  }
+
+  EXPECT_EQ(live, 0);
+}
+
+TEST(frame_allocator, allocator_arg_monotonic_arena) {
+  std::byte buffer[4096];
+  std::pmr::monotonic_buffer_resource arena{buffer, sizeof(buffer),
+                                            std::pmr::null_memory_resource()};
+
+  ECORO_ALLOCATOR_ARG_COROUTINE_BEGIN
+  auto child = [](std::allocator_arg_t,
+                  std::pmr::polymorphic_allocator<std::byte>,
+                  int value) -> ecoro::task<int> { co_return value; };
+
+  auto parent = [&child](std::allocator_arg_t,
+                         std::pmr::polymorphic_allocator<std::byte> alloc)
+      -> ecoro::task<int> {
+    const int a = co_await child(std::allocator_arg, alloc, 1);
+    const int b = co_await child(std::allocator_arg, alloc, 2);
+    co_return a + b;
+  };
+  ECORO_ALLOCATOR_ARG_COROUTINE_END
+
+  auto task = parent(std::allocator_arg,
+                     std::pmr::polymorphic_allocator<std::byte>{&arena});
+  EXPECT_EQ(ecoro::sync_wait(task), 3);
+}
@@ -0,0 +1,179 @@
+// Copyright 2022 - present, Mikhail Svetkin
+// All rights reserved.
+//
+// For the license information refer to LICENSE
+
+#include "ecoro/hedge.hpp"
+#include "ecoro/manual_reset_event.hpp"
+#include "ecoro/sync_wait.hpp"
+#include "ecoro/until_stopped.hpp"
+
+#include "gtest/gtest.h"
+#include "helpers/manual_scheduler.hpp"
+
+#include <array>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+
+using namespace std::chrono_literals;
+
+TEST(hedge, without_scheduler) {
+  int attempts = 0;
+  auto attempt = [&attempts]() -> ecoro::task<int> { co_return ++attempts; };
+
+  EXPECT_EQ(ecoro::sync_wait(ecoro::hedge(attempt, 1ms, 3)), 1);
+  EXPECT_EQ(attempts, 1);
+}
+
+TEST(hedge, no_attempts) {
+  auto attempt = []() -> ecoro::task<void> { co_return; };
+
+  EXPECT_THROW(ecoro::sync_wait(ecoro::hedge(attempt, 1ms, 0)),
+               std::invalid_argument);
+}
+
+TEST(hedge, fast_first_attempt) {
+  ecoro::helpers::manual_scheduler scheduler;
+  int attempts = 0;
+
+  auto attempt = [&attempts]() -> ecoro::task<int> { co_return attempts++; };
+
+  auto task = ecoro::hedge(attempt, 50ms, 3);
+  task.set_scheduler(&scheduler);
+  task.resume();
+
+  // The speculative attempts were never started, so no timer is left.
+  ASSERT_TRUE(task.done());
+  EXPECT_EQ(task.result(), 0);
+  EXPECT_EQ(attempts, 1);
+  EXPECT_EQ(scheduler.pending_timers(), 0);
+}
+
+TEST(hedge, slow_first_attempt) {
+  ecoro::helpers::manual_scheduler scheduler;
+  ecoro::manual_reset_event reply;
+  int attempts = 0;
+  int finished = 0;
+
+  auto attempt = [&]() -> ecoro::task<int> {
+    const auto id = attempts++;
+    if (id == 0) {
+      // The first attempt is stuck until it is cancelled.
+      co_await ecoro::until_stopped(co_await ecoro::this_coro::stop_token());
+      throw ecoro::operation_cancelled{};
+    }
+
+    co_await reply;
+    ++finished;
+    co_return id;
+  };
+
+  auto task = ecoro::hedge(attempt, 50ms, 3);
+  task.set_scheduler(&scheduler);
+  task.resume();
+  EXPECT_EQ(attempts, 1);
+  EXPECT_EQ(scheduler.pending_timers(), 2);
+
+  // The first delay elapses, the retry starts and gets its reply.
+  ASSERT_TRUE(scheduler.fire_next_timer());
+  EXPECT_EQ(attempts, 2);
+  reply.set();
+
+  // hedge returns right away, the stuck attempt and the pending delay of
+  // the third one are cancelled and unwind on the scheduler afterwards.
+  ASSERT_TRUE(task.done());
+  EXPECT_EQ(task.result(), 1);
+  EXPECT_EQ(scheduler.pending_timers(), 0);
+  scheduler.run();
+
+  EXPECT_EQ(attempts, 2);
+  EXPECT_EQ(finished, 1);
+}
+
+TEST(hedge, failed_attempt_does_not_win) {
+  ecoro::helpers::manual_scheduler scheduler;
+  int attempts = 0;
+
+  auto attempt = [&attempts]() -> ecoro::task<int> {
+    const auto id = attempts++;
+    if (id == 0) {
+      throw std::runtime_error{"unavailable"};
+    }
+    co_return id;
+  };
+
+  auto task = ecoro::hedge(attempt, 50ms, 2);
+  task.set_scheduler(&scheduler);
+  task.resume();
+
+  // The first attempt failed, hedge keeps waiting for the second one.
+  EXPECT_EQ(attempts, 1);
+  EXPECT_FALSE(task.done());
+
+  ASSERT_TRUE(scheduler.fire_next_timer());
+  ASSERT_TRUE(task.done());
+  EXPECT_EQ(task.result(), 1);
+  scheduler.run();
+}
+
+TEST(hedge, every_attempt_failed) {
+  ecoro::helpers::manual_scheduler scheduler;
+  int attempts = 0;
+
+  auto attempt = [&attempts]() -> ecoro::task<int> {
+    throw std::runtime_error{std::to_string(attempts++)};
+    co_return 0;
+  };
+
+  auto task = ecoro::hedge(attempt, 50ms, 3);
+  task.set_scheduler(&scheduler);
+  task.resume();
+  ASSERT_TRUE(scheduler.fire_next_timer());
+  ASSERT_TRUE(scheduler.fire_next_timer());
+  ASSERT_TRUE(task.done());
+  EXPECT_EQ(attempts, 3);
+
+  // The last failure is the one rethrown.
+  try {
+    task.result();
+    ADD_FAILURE() << "hedge did not throw";
+  } catch (const std::runtime_error &error) {
+    EXPECT_STREQ(error.what(), "2");
+  }
+  scheduler.run();
+}
+
+TEST(hedge, every_attempt_started) {
+  ecoro::helpers::manual_scheduler scheduler;
+  std::array<ecoro::manual_reset_event, 3> replies;
+  int attempts = 0;
+
+  auto attempt = [&]() -> ecoro::task<int> {
+    const auto id = attempts++;
+    const auto token = co_await ecoro::this_coro::stop_token();
+    co_await replies[id];
+    if (token.stop_requested()) {
+      throw ecoro::operation_cancelled{};
+    }
+    co_return id;
+  };
+
+  auto task = ecoro::hedge(attempt, 50ms, 3);
+  task.set_scheduler(&scheduler);
+  task.resume();
+
+  ASSERT_TRUE(scheduler.fire_next_timer());
+  ASSERT_TRUE(scheduler.fire_next_timer());
+  EXPECT_FALSE(scheduler.fire_next_timer());
+  EXPECT_EQ(attempts, 3);
+
+  // The last attempt answers first, the others finish once they do.
+  replies[2].set();
+  ASSERT_TRUE(task.done());
+  EXPECT_EQ(task.result(), 2);
+
+  replies[0].set();
+  replies[1].set();
+  scheduler.run();
+}
@@ -0,0 +1,82 @@
+// Copyright 2022 - present, Mikhail Svetkin
+// All rights reserved.
+//
+// For the license information refer to LICENSE
+
+#include "ecoro/inplace_stop_token.hpp"
+
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <thread>
+
+static_assert(sizeof(ecoro::inplace_stop_token) == sizeof(void *));
+
+TEST(inplace_stop_token, initial_state) {
+  ecoro::inplace_stop_token empty;
+  EXPECT_FALSE(empty.stop_possible());
+  EXPECT_FALSE(empty.stop_requested());
+
+  ecoro::inplace_stop_source source;
+  const auto token = source.get_token();
+  EXPECT_TRUE(token.stop_possible());
+  EXPECT_FALSE(token.stop_requested());
+  EXPECT_EQ(token, source.get_token());
+  EXPECT_NE(token, empty);
+}
+
+TEST(inplace_stop_token, stop) {
+  ecoro::inplace_stop_source source;
+  const auto token = source.get_token();
+
+  source.request_stop();
+  EXPECT_TRUE(source.stop_requested());
+  EXPECT_TRUE(token.stop_requested());
+}
+
+TEST(inplace_stop_token, stop_callback) {
+  ecoro::inplace_stop_source source;
+
+  int calls = 0;
+  {
+    ecoro::inplace_stop_callback removed{source.get_token(),
+                                         [&calls] { ++calls; }};
+  }
+
+  ecoro::inplace_stop_callback callback{source.get_token(),
+                                        [&calls] { ++calls; }};
+  EXPECT_EQ(calls, 0);
+
+  source.request_stop();
+  EXPECT_EQ(calls, 1);
+
+  ecoro::inplace_stop_callback late{source.get_token(),
+                                    [&calls] { ++calls; }};
+  EXPECT_EQ(calls, 2);
+}
+
+TEST(inplace_stop_token, callback_without_state) {
+  bool called = false;
+  ecoro::inplace_stop_callback callback{ecoro::inplace_stop_token{},
+                                        [&called] { called = true; }};
+  EXPECT_FALSE(called);
+}
+
+TEST(inplace_stop_token, concurrent_callback_and_stop) {
+  for (int i = 0; i < 100; i++) {
+    ecoro::inplace_stop_source source;
+    std::atomic<bool> cancelled = false;
+
+    std::thread waiter{[token = source.get_token(), &cancelled] {
+      while (!cancelled) {
+        ecoro::inplace_stop_callback callback{token,
+                                              [&cancelled] { cancelled = true; }};
+        std::this_thread::yield();
+      }
+    }};
+    std::thread canceller{[&source] { source.request_stop(); }};
+
+    canceller.join();
+    waiter.join();
+  }
+}
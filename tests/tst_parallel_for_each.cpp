@@ -0,0 +1,170 @@
+// Copyright 2022 - present, Mikhail Svetkin
+// All rights reserved.
+//
+// For the license information refer to LICENSE
+
+#include "ecoro/manual_reset_event.hpp"
+#include "ecoro/parallel_for_each.hpp"
+#include "ecoro/sync_wait.hpp"
+#include "ecoro/this_coro.hpp"
+#include "ecoro/thread_pool.hpp"
+
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <chrono>
+#include <list>
+#include <ranges>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct ignore {
+  ecoro::task<void> operator()(int) const {
+    co_return;
+  }
+};
+
+template<typename Range>
+concept can_parallel_for_each = requires(Range &&range) {
+  ecoro::parallel_for_each(std::forward<Range>(range), 1, ignore{});
+};
+
+// Workers hold on to the elements they took, so single-pass ranges are
+// rejected.
+static_assert(can_parallel_for_each<std::vector<int> &>);
+static_assert(can_parallel_for_each<std::list<int>>);
+static_assert(!can_parallel_for_each<std::ranges::istream_view<int> &>);
+
+}  // namespace
+
+TEST(parallel_for_each, visits_every_element) {
+  std::vector<int> values(1'000);
+  for (int i = 0; i < 1'000; ++i) {
+    values[i] = i;
+  }
+
+  long long sum = 0;
+  ecoro::sync_wait(ecoro::parallel_for_each(
+      values, 16, [&sum](int value) -> ecoro::task<void> {
+        sum += value;
+        co_return;
+      }));
+
+  EXPECT_EQ(sum, 999 * 1'000 / 2);
+}
+
+TEST(parallel_for_each, empty_range) {
+  std::list<int> values;
+  int calls = 0;
+
+  ecoro::sync_wait(ecoro::parallel_for_each(
+      values, 4, [&calls](int) -> ecoro::task<void> {
+        ++calls;
+        co_return;
+      }));
+
+  EXPECT_EQ(calls, 0);
+}
+
+TEST(parallel_for_each, limits_in_flight) {
+  using namespace std::chrono_literals;
+
+  ecoro::thread_pool pool{4};
+  std::vector<int> values(200);
+  std::atomic<int> in_flight{0};
+  std::atomic<int> max_in_flight{0};
+  std::atomic<int> done{0};
+
+  auto body = [&](int) -> ecoro::task<void> {
+    const int now = in_flight.fetch_add(1) + 1;
+    int seen = max_in_flight.load();
+    while (now > seen && !max_in_flight.compare_exchange_weak(seen, now)) {
+    }
+
+    co_await ecoro::this_coro::sleep_for(1ms);
+    in_flight.fetch_sub(1);
+    done.fetch_add(1);
+  };
+
+  auto run = ecoro::parallel_for_each(values, 8, body);
+  run.set_scheduler(&pool);
+  ecoro::sync_wait(run);
+
+  EXPECT_EQ(done.load(), 200);
+  EXPECT_LE(max_in_flight.load(), 8);
+  EXPECT_GT(max_in_flight.load(), 1);
+}
+
+TEST(parallel_for_each, stops_after_exception) {
+  std::vector<int> values(100);
+  for (int i = 0; i < 100; ++i) {
+    values[i] = i;
+  }
+
+  int calls = 0;
+  auto body = [&calls](int value) -> ecoro::task<void> {
+    ++calls;
+    if (value == 10) {
+      throw std::runtime_error{"failed"};
+    }
+    co_return;
+  };
+
+  EXPECT_THROW(ecoro::sync_wait(ecoro::parallel_for_each(values, 1, body)),
+               std::runtime_error);
+  EXPECT_EQ(calls, 11);
+}
+
+TEST(parallel_for_each, rethrows_first_failure) {
+  ecoro::manual_reset_event event;
+  auto body = [&event](int value) -> ecoro::task<void> {
+    if (value == 0) {
+      co_await event;
+    }
+    throw std::runtime_error{std::to_string(value)};
+  };
+
+  auto task = ecoro::parallel_for_each(std::vector<int>{0, 1}, 2, body);
+  task.resume();
+
+  // The second element fails first, the first one fails once it resumes.
+  event.set();
+  ASSERT_TRUE(task.done());
+  try {
+    task.result();
+    ADD_FAILURE() << "parallel_for_each did not throw";
+  } catch (const std::runtime_error &error) {
+    EXPECT_STREQ(error.what(), "1");
+  }
+}
+
+TEST(parallel_for_each, owns_rvalue_range) {
+  long long sum = 0;
+  auto body = [&sum](int value) -> ecoro::task<void> {
+    sum += value;
+    co_return;
+  };
+
+  // The temporaries are gone by the time the tasks start.
+  auto from_vector =
+      ecoro::parallel_for_each(std::vector<int>{1, 2, 3, 4}, 2, body);
+  auto from_view = ecoro::parallel_for_each(std::views::iota(0, 100), 3, body);
+
+  ecoro::sync_wait(from_vector);
+  EXPECT_EQ(sum, 10);
+
+  ecoro::sync_wait(from_view);
+  EXPECT_EQ(sum, 10 + 99 * 100 / 2);
+}
+
+TEST(parallel_for_each, zero_in_flight) {
+  std::vector<int> values(10);
+  auto body = [](int) -> ecoro::task<void> { co_return; };
+
+  EXPECT_THROW((void)ecoro::parallel_for_each(values, 0, body),
+               std::invalid_argument);
+}
@@ -0,0 +1,130 @@
+// Copyright 2022 - present, Mikhail Svetkin
+// All rights reserved.
+//
+// For the license information refer to LICENSE
+
+#include "ecoro/scope_guard.hpp"
+
+#include "gtest/gtest.h"
+
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+TEST(scope_guard, calls_on_exit) {
+  int calls = 0;
+  {
+    ecoro::scope_guard guard{[&calls] { ++calls; }};
+    EXPECT_EQ(calls, 0);
+  }
+  EXPECT_EQ(calls, 1);
+}
+
+TEST(scope_guard, moved_from_does_not_call) {
+  int calls = 0;
+  {
+    ecoro::scope_guard guard{[&calls] { ++calls; }};
+    auto other = std::move(guard);
+  }
+  EXPECT_EQ(calls, 1);
+}
+
+TEST(scope_guard, move_assignment) {
+  int first = 0;
+  int second = 0;
+  {
+    auto make_guard = [](int &calls) {
+      return ecoro::scope_guard{[&calls] { ++calls; }};
+    };
+
+    auto guard = make_guard(first);
+    auto other = make_guard(second);
+    {
+      // The replaced callback is dropped, the moved one runs once.
+      guard = std::move(other);
+      EXPECT_EQ(first, 0);
+    }
+    EXPECT_EQ(second, 0);
+  }
+  EXPECT_EQ(first, 0);
+  EXPECT_EQ(second, 1);
+}
+
+TEST(scope_guard, member_function) {
+  struct counter {
+    void increment() {
+      ++calls;
+    }
+
+    int calls{0};
+  };
+
+  counter c;
+  {
+    ecoro::scope_guard guard{&c, &counter::increment};
+  }
+  EXPECT_EQ(c.calls, 1);
+}
+
+TEST(scope_guard, different_callbacks_share_a_type) {
+  int calls = 0;
+  {
+    std::vector<ecoro::scope_guard> guards;
+    guards.emplace_back([&calls] { ++calls; });
+    guards.emplace_back([&calls] { calls += 10; });
+  }
+  EXPECT_EQ(calls, 11);
+}
+
+TEST(basic_scope_guard, calls_on_exit) {
+  int calls = 0;
+  {
+    ecoro::basic_scope_guard guard{[&calls] { ++calls; }};
+    auto other = std::move(guard);
+    EXPECT_EQ(calls, 0);
+  }
+  EXPECT_EQ(calls, 1);
+}
+
+TEST(basic_scope_guard, move_assignment) {
+  int first = 0;
+  int second = 0;
+  {
+    auto make_guard = [](int &calls) {
+      return ecoro::basic_scope_guard{[&calls] { ++calls; }};
+    };
+
+    auto guard = make_guard(first);
+    guard = make_guard(second);
+    EXPECT_EQ(first, 0);
+    EXPECT_EQ(second, 0);
+  }
+  EXPECT_EQ(first, 0);
+  EXPECT_EQ(second, 1);
+}
+
+TEST(basic_scope_guard, member_function) {
+  struct counter {
+    void increment() {
+      ++calls;
+    }
+
+    int calls{0};
+  };
+
+  counter c;
+  {
+    ecoro::basic_scope_guard guard{&c, &counter::increment};
+  }
+  EXPECT_EQ(c.calls, 1);
+}
+
+TEST(basic_scope_guard, no_type_erasure) {
+  int calls = 0;
+  auto callback = [&calls] { ++calls; };
+  using guard_type = ecoro::basic_scope_guard<decltype(callback)>;
+
+  static_assert(sizeof(guard_type) <= 2 * sizeof(void *));
+  static_assert(std::is_nothrow_move_constructible_v<guard_type>);
+  static_assert(std::is_nothrow_move_assignable_v<guard_type>);
+}
@@ -4,12 +4,16 @@
 // For the license information refer to LICENSE
 
 #include "ecoro/stop_token.hpp"
+#include "ecoro/thread_pool.hpp"
 
 #include "gtest/gtest.h"
 
 #include <atomic>
-#include <thread>
+#include <chrono>
 #include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
 
 TEST(stop_token, initial_state) {
   ecoro::stop_source stop_source{ecoro::nostopstate};
@@ -166,3 +170,276 @@ TEST(stop_token, move_token_and_move_callback) {
   ecoro::stop_callback callback4(std::move(token), std::move(f));
   ASSERT_EQ(called, false);
 }
+
+TEST(stop_token, callback_destroyed_after_stop) {
+  ecoro::stop_source source;
+  int calls = 0;
+
+  {
+    ecoro::stop_callback callback1(source.get_token(), [&calls] { ++calls; });
+    ecoro::stop_callback callback2(source.get_token(), [&calls] { ++calls; });
+    source.request_stop();
+  }
+
+  ecoro::stop_callback callback3(source.get_token(), [&calls] { ++calls; });
+  EXPECT_EQ(calls, 3);
+}
+
+TEST(stop_token, callback_destroys_itself) {
+  ecoro::stop_source source;
+
+  using callback_type = ecoro::stop_callback<std::function<void()>>;
+  std::unique_ptr<callback_type> callback;
+  callback = std::make_unique<callback_type>(
+      source.get_token(), [&callback] { callback.reset(); });
+
+  source.request_stop();
+  EXPECT_EQ(callback, nullptr);
+}
+
+TEST(stop_token, deregister_waits_for_running_callback) {
+  for (int i = 0; i < 100; i++) {
+    ecoro::stop_source source;
+    std::atomic<bool> entered{false};
+    std::atomic<bool> finished{false};
+
+    auto callback = std::make_unique<ecoro::stop_callback<std::function<void()>>>(
+        source.get_token(), [&] {
+          entered = true;
+          std::this_thread::sleep_for(std::chrono::microseconds(100));
+          finished = true;
+        });
+
+    std::thread canceller{[&source] { source.request_stop(); }};
+    while (!entered) {
+      std::this_thread::yield();
+    }
+
+    callback.reset();
+    EXPECT_TRUE(finished);
+    canceller.join();
+  }
+}
+
+TEST(stop_token, callback_destroys_another_callback) {
+  ecoro::stop_source source;
+
+  using callback_type = ecoro::stop_callback<std::function<void()>>;
+  std::unique_ptr<callback_type> first;
+  std::unique_ptr<callback_type> second;
+  int calls = 0;
+
+  // Whichever runs first destroys the other one, the second is either
+  // unlinked before it runs or has already run.
+  first = std::make_unique<callback_type>(source.get_token(), [&] {
+    ++calls;
+    second.reset();
+  });
+  second = std::make_unique<callback_type>(source.get_token(), [&] {
+    ++calls;
+    first.reset();
+  });
+
+  source.request_stop();
+  EXPECT_EQ(calls, 1);
+}
+
+TEST(stop_token, register_while_callback_runs) {
+  ecoro::stop_source source;
+  std::atomic<bool> entered{false};
+  std::atomic<bool> release{false};
+
+  ecoro::stop_callback blocking{source.get_token(), [&] {
+    entered = true;
+    while (!release) {
+      std::this_thread::yield();
+    }
+  }};
+
+  std::thread canceller{[&source] { source.request_stop(); }};
+  while (!entered) {
+    std::this_thread::yield();
+  }
+
+  // The state is not locked while a callback runs, so this neither blocks
+  // nor deadlocks; the stop is already requested, so it runs inline.
+  bool called = false;
+  ecoro::stop_callback late{source.get_token(), [&called] { called = true; }};
+  EXPECT_TRUE(called);
+
+  release = true;
+  canceller.join();
+}
+
+TEST(stop_token, linked_source) {
+  ecoro::stop_source parent;
+  ecoro::stop_source child{parent.get_token()};
+  ecoro::stop_source grandchild{child.get_token()};
+
+  child.request_stop();
+  EXPECT_FALSE(parent.stop_requested());
+  EXPECT_TRUE(grandchild.stop_requested());
+
+  ecoro::stop_source sibling{parent.get_token()};
+  parent.request_stop();
+  EXPECT_TRUE(sibling.stop_requested());
+
+  ecoro::stop_source late{parent.get_token()};
+  EXPECT_TRUE(late.stop_requested());
+
+  ecoro::stop_source orphan{ecoro::stop_token{}};
+  EXPECT_TRUE(orphan.get_token().stop_possible());
+  EXPECT_FALSE(orphan.stop_requested());
+}
+
+TEST(stop_token, linked_source_tree) {
+  ecoro::stop_source root;
+
+  std::vector<ecoro::stop_source> nodes;
+  nodes.reserve(10'000);
+  nodes.emplace_back(root.get_token());
+  for (std::size_t i = 1; i < 1'000; ++i) {
+    nodes.emplace_back(nodes[(i - 1) / 4].get_token());
+  }
+
+  // Unlinking in the middle of the tree leaves the rest linked.
+  nodes.erase(nodes.begin() + 5'000, nodes.begin() + 5'010);
+
+  root.request_stop();
+  for (const auto &node : nodes) {
+    ASSERT_TRUE(node.stop_requested());
+  }
+}
+
+TEST(stop_token, linked_source_released_by_callback) {
+  ecoro::stop_source parent;
+  auto child = std::make_unique<ecoro::stop_source>(parent.get_token());
+  bool stopped = false;
+
+  // The callback drops the only reference to the linked state while the
+  // stop of the parent still propagates through it.
+  ecoro::stop_callback callback{child->get_token(), [&child, &stopped] {
+                                  child.reset();
+                                  stopped = true;
+                                }};
+
+  parent.request_stop();
+  EXPECT_TRUE(stopped);
+  EXPECT_FALSE(child);
+}
+
+TEST(stop_token, linked_source_concurrent_unlink) {
+  for (int i = 0; i < 100; i++) {
+    ecoro::stop_source parent;
+    std::atomic<bool> done{false};
+
+    std::thread linker{[token = parent.get_token(), &done] {
+      while (!done) {
+        ecoro::stop_source child{token};
+        ecoro::stop_callback callback{child.get_token(),
+                                      [&done] { done = true; }};
+        std::this_thread::yield();
+      }
+    }};
+    std::thread canceller{[&parent] { parent.request_stop(); }};
+
+    canceller.join();
+    linker.join();
+  }
+}
+
+TEST(stop_token, request_stop_after) {
+  using namespace std::chrono_literals;
+
+  ecoro::thread_pool pool{1};
+  ecoro::stop_source source;
+  EXPECT_FALSE(source.deadline());
+
+  std::atomic<bool> stopped{false};
+  ecoro::stop_callback callback{source.get_token(),
+                                [&stopped] { stopped = true; }};
+
+  const auto started = std::chrono::steady_clock::now();
+  source.request_stop_after(pool, 20ms);
+  ASSERT_TRUE(source.get_token().deadline());
+  EXPECT_GE(*source.get_token().deadline(), started + 20ms);
+
+  while (!stopped) {
+    std::this_thread::yield();
+  }
+  EXPECT_GE(std::chrono::steady_clock::now() - started, 20ms);
+  EXPECT_TRUE(source.stop_requested());
+}
+
+TEST(stop_token, tighter_deadline_wins) {
+  using namespace std::chrono_literals;
+
+  ecoro::thread_pool pool{1};
+  ecoro::stop_source parent;
+  parent.request_stop_after(pool, 20ms);
+
+  ecoro::stop_source loose{parent.get_token()};
+  loose.request_stop_after(pool, 10s);
+  EXPECT_EQ(loose.deadline(), parent.deadline());
+
+  ecoro::stop_source tight{parent.get_token()};
+  tight.request_stop_after(pool, 5ms);
+  EXPECT_LT(*tight.deadline(), *parent.deadline());
+
+  // A later deadline on the same source is ignored.
+  const auto deadline = tight.deadline();
+  tight.request_stop_after(pool, 1s);
+  EXPECT_EQ(tight.deadline(), deadline);
+
+  while (!loose.stop_requested()) {
+    std::this_thread::yield();
+  }
+  EXPECT_TRUE(tight.stop_requested());
+}
+
+TEST(stop_token, deadline_outlived_by_scheduler) {
+  using namespace std::chrono_literals;
+
+  ecoro::thread_pool pool{2};
+
+  // Sources that die with their deadline pending take their timers along,
+  // the ones that expire meanwhile are released by the scheduler.
+  for (int i = 0; i < 1'000; ++i) {
+    ecoro::stop_source source;
+    source.request_stop_after(pool, std::chrono::microseconds(i % 50));
+    if (i % 3 == 0) {
+      source.request_stop();
+    }
+  }
+
+  std::this_thread::sleep_for(10ms);
+}
+
+TEST(stop_token, linked_deadline_destroyed_during_parent_stop) {
+  using namespace std::chrono_literals;
+
+  ecoro::thread_pool pool{1};
+
+  // The parent stops while the linked sources with their pending deadlines
+  // die, each timer is cancelled by exactly one of them.
+  for (int i = 0; i < 100; ++i) {
+    ecoro::stop_source parent;
+    std::vector<ecoro::stop_source> children;
+    for (int j = 0; j < 1'000; ++j) {
+      children.emplace_back(parent.get_token()).request_stop_after(pool, 1h);
+    }
+
+    std::atomic<int> started{0};
+    std::thread canceller{[&parent, &started] {
+      for (++started; started != 2;) {
+      }
+      parent.request_stop();
+    }};
+    for (++started; started != 2;) {
+    }
+    while (!children.empty()) {
+      children.pop_back();
+    }
+    canceller.join();
+  }
+}
@@ -6,6 +6,7 @@
 #include "ecoro/detail/compiler.hpp"
 #include "ecoro/sync_wait.hpp"
 #include "ecoro/task.hpp"
+#include "ecoro/this_coro.hpp"
 #include "gtest/gtest.h"
 #include "helpers/noisy.hpp"
 
@@ -29,6 +30,12 @@ inline constexpr bool is_copyible_v =
 static_assert(!is_copy_assign_v<ecoro::task<void>>,
               "Task should not support asign");
 
+static_assert(!std::is_polymorphic_v<ecoro::task<void>>,
+              "Task should not have a vtable");
+
+static_assert(sizeof(ecoro::task<int>) == sizeof(void *),
+              "Task should be a single pointer");
+
 TEST(task, initial_state) {
   ecoro::task<void> taskVoid;
   EXPECT_FALSE(taskVoid);
@@ -396,3 +403,25 @@ TEST(task, with_arg_rvalue_implicit) {
   EXPECT_EQ(noisy.counter()->assign_copy, 0);
   EXPECT_EQ(noisy.counter()->dtor, 0);
 }
+
+TEST(task, inherit_stop_token) {
+  ecoro::stop_source source;
+
+  auto leaf = []() -> ecoro::task<ecoro::stop_token> {
+    co_return co_await ecoro::this_coro::stop_token();
+  };
+
+  auto middle = [&leaf]() -> ecoro::task<ecoro::stop_token> {
+    co_return co_await leaf();
+  };
+
+  auto root = middle();
+  root.set_stop_token(source.get_token());
+
+  const auto token = ecoro::sync_wait(root);
+  EXPECT_TRUE(token.stop_possible());
+  EXPECT_FALSE(token.stop_requested());
+
+  source.request_stop();
+  EXPECT_TRUE(token.stop_requested());
+}
@@ -0,0 +1,303 @@
+// Copyright 2022 - present, Mikhail Svetkin
+// All rights reserved.
+//
+// For the license information refer to LICENSE
+
+#include "ecoro/sync_wait.hpp"
+#include "ecoro/task.hpp"
+#include "ecoro/this_coro.hpp"
+#include "ecoro/thread_pool.hpp"
+
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+namespace {
+
+std::atomic<std::size_t> allocations{0};
+
+}  // namespace
+
+// Counts every allocation of the test binary, so that a test can check that
+// a piece of code allocates nothing.
+void *operator new(const std::size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void *ptr = std::malloc(size)) {
+    return ptr;
+  }
+  throw std::bad_alloc{};
+}
+
+void operator delete(void *ptr) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept {
+  std::free(ptr);
+}
+
+namespace {
+
+void join(ecoro::thread_pool &pool) {
+  ecoro::sync_wait([&pool]() -> ecoro::task<void> {
+    co_await pool.join();
+  });
+}
+
+}  // namespace
+
+TEST(thread_pool, initial_state) {
+  ecoro::thread_pool pool{4};
+  EXPECT_EQ(pool.thread_count(), 4);
+
+  ecoro::thread_pool empty_pool{0};
+  EXPECT_EQ(empty_pool.thread_count(), 1);
+}
+
+TEST(thread_pool, schedule) {
+  ecoro::thread_pool pool{2};
+  const auto main_thread_id = std::this_thread::get_id();
+
+  const auto worker_thread_id =
+      ecoro::sync_wait([&pool]() -> ecoro::task<std::thread::id> {
+        co_await pool.schedule();
+        co_return std::this_thread::get_id();
+      });
+
+  EXPECT_NE(worker_thread_id, main_thread_id);
+}
+
+TEST(thread_pool, schedule_after) {
+  using namespace std::chrono_literals;
+
+  ecoro::thread_pool pool{2};
+
+  const auto started = std::chrono::steady_clock::now();
+  ecoro::sync_wait([&pool]() -> ecoro::task<void> {
+    co_await pool.schedule_after(20ms);
+  });
+
+  EXPECT_GE(std::chrono::steady_clock::now() - started, 20ms);
+}
+
+TEST(thread_pool, timed_waits_do_not_allocate) {
+  using namespace std::chrono_literals;
+
+  static_assert(std::is_same_v<decltype(std::declval<ecoro::thread_pool &>()
+                                            .schedule_after(1ms)),
+                               ecoro::scheduler::timer_awaiter>);
+
+  ecoro::thread_pool pool{1};
+
+  std::size_t allocated = 0;
+  auto task = [](ecoro::thread_pool &pool,
+                 std::size_t &allocated) -> ecoro::task<void> {
+    co_await pool.schedule();
+
+    // The timer operations live in this frame, a timed wait adds nothing.
+    const auto before = allocations.load(std::memory_order_relaxed);
+    co_await pool.schedule_after(1ms);
+    co_await pool.schedule_at(std::chrono::steady_clock::now() + 1ms);
+    co_await ecoro::this_coro::sleep_for(1ms);
+    allocated = allocations.load(std::memory_order_relaxed) - before;
+  }(pool, allocated);
+  task.set_scheduler(&pool);
+  ecoro::sync_wait(task);
+
+  EXPECT_EQ(allocated, 0);
+}
+
+TEST(thread_pool, schedule_at) {
+  using namespace std::chrono_literals;
+
+  ecoro::thread_pool pool{2};
+
+  const auto deadline = std::chrono::steady_clock::now() + 20ms;
+  ecoro::sync_wait([&pool, deadline]() -> ecoro::task<void> {
+    co_await pool.schedule_at(deadline);
+  });
+
+  EXPECT_GE(std::chrono::steady_clock::now(), deadline);
+}
+
+TEST(thread_pool, spawn_and_join) {
+  ecoro::thread_pool pool{4};
+  std::atomic<int> counter{0};
+
+  constexpr int count = 10'000;
+  for (int i = 0; i < count; ++i) {
+    pool.spawn([&counter]() -> ecoro::task<void> {
+      counter.fetch_add(1, std::memory_order_relaxed);
+      co_return;
+    });
+  }
+
+  join(pool);
+  EXPECT_EQ(counter.load(), count);
+}
+
+TEST(thread_pool, nested_fan_out) {
+  ecoro::thread_pool pool{4};
+  std::atomic<int> counter{0};
+
+  auto leaf = [](std::atomic<int> &counter) -> ecoro::task<void> {
+    counter.fetch_add(1, std::memory_order_relaxed);
+    co_return;
+  };
+
+  for (int i = 0; i < 100; ++i) {
+    pool.spawn(
+        [&pool, &leaf](std::atomic<int> &counter) -> ecoro::task<void> {
+          for (int j = 0; j < 100; ++j) {
+            pool.spawn(leaf, counter);
+          }
+          co_return;
+        },
+        counter);
+  }
+
+  join(pool);
+  EXPECT_EQ(counter.load(), 100 * 100);
+}
+
+TEST(thread_pool, timers_from_many_tasks) {
+  using namespace std::chrono_literals;
+
+  ecoro::thread_pool pool{4};
+  std::atomic<int> counter{0};
+
+  for (int i = 0; i < 1'000; ++i) {
+    pool.spawn(
+        [](std::atomic<int> &counter, auto delay) -> ecoro::task<void> {
+          co_await ecoro::this_coro::sleep_for(delay);
+          counter.fetch_add(1, std::memory_order_relaxed);
+        },
+        counter, std::chrono::milliseconds(i % 10));
+  }
+
+  join(pool);
+  EXPECT_EQ(counter.load(), 1'000);
+}
+
+TEST(thread_pool, deadline_cancels_sleep) {
+  using namespace std::chrono_literals;
+
+  ecoro::thread_pool pool{2};
+  ecoro::stop_source source;
+  source.request_stop_after(pool, 20ms);
+
+  auto task = []() -> ecoro::task<void> {
+    co_await ecoro::this_coro::sleep_for(2s);
+  }();
+  task.set_scheduler(&pool);
+  task.set_stop_token(source.get_token());
+
+  const auto started = std::chrono::steady_clock::now();
+  EXPECT_THROW(ecoro::sync_wait(task), ecoro::operation_cancelled);
+  EXPECT_LT(std::chrono::steady_clock::now() - started, 1s);
+}
+
+TEST(thread_pool, stopped_before_schedule_after) {
+  using namespace std::chrono_literals;
+
+  ecoro::thread_pool pool{2};
+  ecoro::stop_source source;
+  source.request_stop();
+
+  auto task = [](ecoro::thread_pool &pool) -> ecoro::task<void> {
+    co_await pool.schedule_after(2s);
+  }(pool);
+  task.set_stop_token(source.get_token());
+
+  EXPECT_THROW(ecoro::sync_wait(task), ecoro::operation_cancelled);
+}
+
+TEST(thread_pool, join_after_cancelled_sleeps) {
+  using namespace std::chrono_literals;
+
+  ecoro::thread_pool pool{4};
+  std::atomic<int> cancelled{0};
+
+  for (int i = 0; i < 100; ++i) {
+    pool.spawn(
+        [](ecoro::thread_pool &pool,
+           std::atomic<int> &cancelled) -> ecoro::task<void> {
+          ecoro::stop_source source;
+          source.request_stop_after(pool, 5ms);
+
+          auto sleeper = []() -> ecoro::task<void> {
+            co_await ecoro::this_coro::sleep_for(2s);
+          }();
+          sleeper.set_stop_token(source.get_token());
+
+          try {
+            co_await sleeper;
+          } catch (const ecoro::operation_cancelled &) {
+            cancelled.fetch_add(1, std::memory_order_relaxed);
+          }
+        },
+        pool, cancelled);
+  }
+
+  join(pool);
+  EXPECT_EQ(cancelled.load(), 100);
+}
+
+TEST(thread_pool, yield) {
+  ecoro::thread_pool pool{1};
+  std::atomic<int> counter{0};
+  std::atomic<int> seen_by_yielder{-1};
+
+  pool.spawn([&]() -> ecoro::task<void> {
+    pool.spawn([&counter]() -> ecoro::task<void> {
+      counter.fetch_add(1, std::memory_order_relaxed);
+      co_return;
+    });
+
+    co_await ecoro::this_coro::yield();
+    seen_by_yielder = counter.load();
+  });
+
+  join(pool);
+  EXPECT_EQ(seen_by_yielder.load(), 1);
+}
+
+TEST(thread_pool, yield_without_scheduler) {
+  const auto thread_id =
+      ecoro::sync_wait([]() -> ecoro::task<std::thread::id> {
+        co_await ecoro::this_coro::yield();
+        co_return std::this_thread::get_id();
+      });
+
+  EXPECT_EQ(thread_id, std::this_thread::get_id());
+}
+
+TEST(thread_pool, this_coro_scheduler) {
+  ecoro::thread_pool pool{2};
+  std::atomic<ecoro::scheduler *> scheduler{nullptr};
+
+  pool.spawn([&scheduler]() -> ecoro::task<void> {
+    scheduler = co_await ecoro::this_coro::scheduler();
+  });
+
+  join(pool);
+  EXPECT_EQ(scheduler.load(), &pool);
+}
+
+TEST(thread_pool, set_scheduler) {
+  ecoro::thread_pool pool{2};
+
+  auto task = []() -> ecoro::task<ecoro::scheduler *> {
+    co_return co_await ecoro::this_coro::scheduler();
+  }();
+  task.set_scheduler(&pool);
+
+  EXPECT_EQ(ecoro::sync_wait(task), &pool);
+}
@@ -0,0 +1,205 @@
+// Copyright 2022 - present, Mikhail Svetkin
+// All rights reserved.
+//
+// For the license information refer to LICENSE
+
+#include "ecoro/timer_wheel.hpp"
+
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <random>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace {
+
+using clock_type = ecoro::timer_wheel::clock;
+
+const clock_type::time_point start{};
+
+struct timer : ecoro::timer_node {
+  explicit timer(const clock_type::duration after) noexcept {
+    deadline = start + after;
+  }
+
+  int fired{0};
+};
+
+auto collect(std::vector<timer *> &fired) {
+  return [&fired](ecoro::timer_node &node) {
+    auto &t = static_cast<timer &>(node);
+    t.fired++;
+    fired.push_back(&t);
+  };
+}
+
+}  // namespace
+
+TEST(timer_wheel, initial_state) {
+  ecoro::timer_wheel wheel{1ms, start};
+  EXPECT_TRUE(wheel.empty());
+  EXPECT_EQ(wheel.size(), 0);
+  EXPECT_FALSE(wheel.next_deadline().has_value());
+  EXPECT_EQ(wheel.advance(start + 1h, [](auto &) {}), 0);
+}
+
+TEST(timer_wheel, expire_in_order) {
+  ecoro::timer_wheel wheel{1ms, start};
+  timer t1{5ms}, t2{1ms}, t3{3ms};
+
+  wheel.add(t1);
+  wheel.add(t2);
+  wheel.add(t3);
+  EXPECT_EQ(wheel.size(), 3);
+  EXPECT_TRUE(t1.pending());
+
+  std::vector<timer *> fired;
+  EXPECT_EQ(wheel.advance(start + 10ms, collect(fired)), 3);
+  EXPECT_EQ(fired, (std::vector{&t2, &t3, &t1}));
+  EXPECT_TRUE(wheel.empty());
+  EXPECT_FALSE(t1.pending());
+}
+
+TEST(timer_wheel, never_fires_early) {
+  ecoro::timer_wheel wheel{1ms, start};
+  timer t{5500us};
+  wheel.add(t);
+
+  std::vector<timer *> fired;
+  wheel.advance(start + 5ms, collect(fired));
+  EXPECT_TRUE(fired.empty());
+
+  wheel.advance(start + 5900us, collect(fired));
+  EXPECT_TRUE(fired.empty());
+
+  wheel.advance(start + 6ms, collect(fired));
+  EXPECT_EQ(fired, (std::vector{&t}));
+}
+
+TEST(timer_wheel, already_expired) {
+  ecoro::timer_wheel wheel{1ms, start};
+  wheel.advance(start + 10ms, [](auto &) {});
+
+  timer t{5ms};
+  wheel.add(t);
+  EXPECT_LE(*wheel.next_deadline(), start + 10ms);
+
+  std::vector<timer *> fired;
+  wheel.advance(start + 10ms, collect(fired));
+  EXPECT_EQ(fired, (std::vector{&t}));
+}
+
+TEST(timer_wheel, remove) {
+  ecoro::timer_wheel wheel{1ms, start};
+  timer t1{5ms}, t2{5ms}, t3{50s};
+
+  wheel.add(t1);
+  wheel.add(t2);
+  wheel.add(t3);
+
+  EXPECT_TRUE(wheel.remove(t1));
+  EXPECT_FALSE(wheel.remove(t1));
+  EXPECT_TRUE(wheel.remove(t3));
+  EXPECT_EQ(wheel.size(), 1);
+
+  std::vector<timer *> fired;
+  wheel.advance(start + 1h, collect(fired));
+  EXPECT_EQ(fired, (std::vector{&t2}));
+  EXPECT_FALSE(wheel.remove(t2));
+}
+
+TEST(timer_wheel, cascade_through_levels) {
+  ecoro::timer_wheel wheel{1ms, start};
+  const std::vector<clock_type::duration> delays = {70ms, 5s,   5min,
+                                                    10h,  100h, 1000h};
+  std::vector<timer> timers;
+  timers.reserve(delays.size());
+  for (const auto delay : delays) {
+    timers.emplace_back(delay);
+  }
+
+  for (auto &t : timers) {
+    wheel.add(t);
+  }
+
+  for (auto &t : timers) {
+    ASSERT_LE(*wheel.next_deadline(), t.deadline);
+
+    std::vector<timer *> fired;
+    wheel.advance(t.deadline - 1ms, collect(fired));
+    EXPECT_TRUE(fired.empty());
+
+    wheel.advance(t.deadline, collect(fired));
+    EXPECT_EQ(fired, (std::vector{&t}));
+  }
+
+  EXPECT_TRUE(wheel.empty());
+}
+
+TEST(timer_wheel, beyond_wheel_range) {
+  ecoro::timer_wheel wheel{1ms, start};
+  timer t{std::chrono::hours(24 * 1000)};
+  wheel.add(t);
+
+  std::vector<timer *> fired;
+  for (auto now = start; now < t.deadline; now += 24h) {
+    wheel.advance(now, collect(fired));
+  }
+  wheel.advance(t.deadline - 1ms, collect(fired));
+  EXPECT_TRUE(fired.empty());
+
+  wheel.advance(t.deadline, collect(fired));
+  EXPECT_EQ(fired, (std::vector{&t}));
+}
+
+TEST(timer_wheel, add_from_callback) {
+  ecoro::timer_wheel wheel{1ms, start};
+  timer t1{1ms}, t2{2ms};
+  wheel.add(t1);
+
+  std::vector<timer *> fired;
+  wheel.advance(start + 5ms, [&](ecoro::timer_node &node) {
+    collect(fired)(node);
+    if (&node == &t1) {
+      wheel.add(t2);
+    }
+  });
+
+  EXPECT_EQ(fired, (std::vector{&t1, &t2}));
+}
+
+TEST(timer_wheel, random_deadlines) {
+  ecoro::timer_wheel wheel{1ms, start};
+  std::mt19937 random{42};
+  std::uniform_int_distribution<int> after{0, 10'000'000};
+
+  std::vector<timer> timers;
+  timers.reserve(10'000);
+  for (int i = 0; i < 10'000; ++i) {
+    timers.emplace_back(std::chrono::microseconds(after(random)));
+    wheel.add(timers.back());
+  }
+
+  auto now = start;
+  std::uniform_int_distribution<int> step{0, 50'000};
+  while (!wheel.empty()) {
+    now += std::chrono::microseconds(step(random));
+    wheel.advance(now, [now](ecoro::timer_node &node) {
+      auto &t = static_cast<timer &>(node);
+      EXPECT_LE(t.deadline, now);
+      t.fired++;
+    });
+
+    for (auto &t : timers) {
+      if (t.deadline + 1ms <= now) {
+        ASSERT_EQ(t.fired, 1);
+      }
+    }
+  }
+
+  for (auto &t : timers) {
+    EXPECT_EQ(t.fired, 1);
+  }
+}
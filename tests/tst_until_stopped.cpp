@@ -0,0 +1,117 @@
+// Copyright 2022 - present, Mikhail Svetkin
+// All rights reserved.
+//
+// For the license information refer to LICENSE
+
+#include "ecoro/sync_wait.hpp"
+#include "ecoro/this_coro.hpp"
+#include "ecoro/thread_pool.hpp"
+#include "ecoro/until_stopped.hpp"
+#include "ecoro/when_first.hpp"
+
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <thread>
+
+using namespace std::chrono_literals;
+
+TEST(until_stopped, already_stopped) {
+  ecoro::stop_source source;
+  source.request_stop();
+
+  ecoro::sync_wait([&source]() -> ecoro::task<void> {
+    co_await ecoro::until_stopped(source.get_token());
+  });
+}
+
+TEST(until_stopped, resume_on_requester_without_scheduler) {
+  ecoro::stop_source source;
+  std::thread::id resumed_on;
+
+  auto make_task = [&]() -> ecoro::task<void> {
+    co_await ecoro::until_stopped(source.get_token());
+    resumed_on = std::this_thread::get_id();
+  };
+  auto task = make_task();
+  task.resume();
+  EXPECT_FALSE(task.done());
+
+  source.request_stop();
+  EXPECT_TRUE(task.done());
+  EXPECT_EQ(resumed_on, std::this_thread::get_id());
+}
+
+TEST(until_stopped, resume_on_scheduler) {
+  ecoro::thread_pool pool{2};
+  ecoro::stop_source source;
+
+  auto make_task = [&]() -> ecoro::task<std::thread::id> {
+    co_await ecoro::until_stopped(source.get_token());
+    co_return std::this_thread::get_id();
+  };
+  auto task = make_task();
+  task.set_scheduler(&pool);
+
+  std::thread canceller{[&source] {
+    std::this_thread::sleep_for(10ms);
+    source.request_stop();
+  }};
+
+  const auto resumed_on = ecoro::sync_wait(task);
+  canceller.join();
+  EXPECT_NE(resumed_on, canceller.get_id());
+  EXPECT_NE(resumed_on, std::this_thread::get_id());
+}
+
+TEST(until_stopped, when_first) {
+  ecoro::thread_pool pool{2};
+  ecoro::stop_source source;
+
+  auto make_run = [&]() -> ecoro::task<bool> {
+    auto work = []() -> ecoro::task<int> {
+      co_await ecoro::this_coro::sleep_for(1s);
+      co_return 1;
+    };
+
+    const auto result = co_await ecoro::when_first(
+        work(), ecoro::until_stopped(source.get_token()));
+    co_return result.has_value();
+  };
+  auto run = make_run();
+  run.set_scheduler(&pool);
+
+  std::thread canceller{[&source] {
+    std::this_thread::sleep_for(10ms);
+    source.request_stop();
+  }};
+
+  const auto started = std::chrono::steady_clock::now();
+  EXPECT_FALSE(ecoro::sync_wait(run));
+  EXPECT_LT(std::chrono::steady_clock::now() - started, 1s);
+  canceller.join();
+}
+
+TEST(until_stopped, deadline) {
+  ecoro::thread_pool pool{2};
+
+  auto make_run = [&pool]() -> ecoro::task<bool> {
+    auto work = []() -> ecoro::task<int> {
+      co_await ecoro::this_coro::sleep_for(1s);
+      co_return 1;
+    };
+
+    ecoro::stop_source deadline{co_await ecoro::this_coro::stop_token()};
+    deadline.request_stop_after(pool, 10ms);
+
+    const auto result = co_await ecoro::when_first(
+        work(), ecoro::until_stopped(deadline.get_token()));
+    co_return result.has_value();
+  };
+  auto run = make_run();
+  run.set_scheduler(&pool);
+
+  const auto started = std::chrono::steady_clock::now();
+  EXPECT_FALSE(ecoro::sync_wait(run));
+  EXPECT_LT(std::chrono::steady_clock::now() - started, 1s);
+}
@@ -5,10 +5,17 @@
 
 #include "ecoro/scope_guard.hpp"
 #include "ecoro/sync_wait.hpp"
+#include "ecoro/this_coro.hpp"
+#include "ecoro/thread_pool.hpp"
 #include "ecoro/when_all.hpp"
 #include "gtest/gtest.h"
+#include "helpers/noisy.hpp"
 
+#include <chrono>
 #include <string>
+#include <stdexcept>
+#include <thread>
+#include <vector>
 
 TEST(when_all, sanity_check) {
   ecoro::sync_wait([]() -> ecoro::task<void> {
@@ -245,3 +252,217 @@ TEST(when_all, switcher) {
   ecoro::sync_wait(task);
   EXPECT_EQ(execution_order, "1234567");
 }
+
+TEST(when_all, children_on_thread_pool) {
+  ecoro::thread_pool pool{4};
+
+  auto child = [&pool](int value) -> ecoro::task<int> {
+    co_await pool.schedule();
+    co_return value;
+  };
+
+  for (int i = 0; i < 1'000; ++i) {
+    auto [a, b, c, d] = ecoro::sync_wait(
+        ecoro::when_all(child(1), child(2), child(3), child(4)));
+
+    EXPECT_EQ(a.result() + b.result() + c.result() + d.result(), 10);
+  }
+}
+
+TEST(when_all, range) {
+  auto child = [](int value) -> ecoro::task<int> { co_return value * 2; };
+
+  std::vector<ecoro::task<int>> tasks;
+  for (int i = 0; i < 100; ++i) {
+    tasks.push_back(child(i));
+  }
+
+  const auto results = ecoro::sync_wait(ecoro::when_all(std::move(tasks)));
+
+  ASSERT_EQ(results.size(), 100);
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQ(results[i], i * 2);
+  }
+}
+
+TEST(when_all, range_empty) {
+  const auto results = ecoro::sync_wait(
+      ecoro::when_all(std::vector<ecoro::task<std::string>>{}));
+  EXPECT_TRUE(results.empty());
+}
+
+TEST(when_all, range_rejects_empty_task) {
+  auto child = []() -> ecoro::task<int> { co_return 1; };
+
+  std::vector<ecoro::task<int>> tasks;
+  tasks.push_back(child());
+  tasks.emplace_back();
+
+  EXPECT_THROW((void)ecoro::when_all(std::move(tasks)), std::invalid_argument);
+}
+
+TEST(when_all, range_void) {
+  int counter = 0;
+  auto child = [&counter]() -> ecoro::task<void> {
+    ++counter;
+    co_return;
+  };
+
+  std::vector<ecoro::task<void>> tasks;
+  tasks.push_back(child());
+  tasks.push_back(child());
+
+  ecoro::sync_wait(ecoro::when_all(std::move(tasks)));
+  EXPECT_EQ(counter, 2);
+}
+
+TEST(when_all, range_exception) {
+  int finished = 0;
+  auto child = [&finished](bool fail) -> ecoro::task<int> {
+    ++finished;
+    if (fail) {
+      throw std::runtime_error{"failed"};
+    }
+    co_return 1;
+  };
+
+  std::vector<ecoro::task<int>> tasks;
+  tasks.push_back(child(false));
+  tasks.push_back(child(true));
+  tasks.push_back(child(false));
+
+  EXPECT_THROW(ecoro::sync_wait(ecoro::when_all(std::move(tasks))),
+               std::runtime_error);
+  EXPECT_EQ(finished, 3);
+}
+
+TEST(when_all, range_on_thread_pool) {
+  ecoro::thread_pool pool{4};
+
+  auto child = [&pool](int value) -> ecoro::task<int> {
+    co_await pool.schedule();
+    co_return value;
+  };
+
+  for (int i = 0; i < 100; ++i) {
+    std::vector<ecoro::task<int>> tasks;
+    for (int j = 0; j < 64; ++j) {
+      tasks.push_back(child(j));
+    }
+
+    const auto results = ecoro::sync_wait(ecoro::when_all(std::move(tasks)));
+    ASSERT_EQ(results.size(), 64);
+    EXPECT_EQ(results.back(), 63);
+  }
+}
+
+TEST(when_all, results) {
+  auto [number, text, nothing] = ecoro::sync_wait(ecoro::when_all_results(
+      []() -> ecoro::task<int> { co_return 42; },
+      []() -> ecoro::task<std::string> { co_return "text"; },
+      []() -> ecoro::task<void> { co_return; }));
+
+  EXPECT_EQ(number, 42);
+  EXPECT_EQ(text, "text");
+  EXPECT_EQ(nothing, std::monostate{});
+}
+
+TEST(when_all, results_destroy_frames_early) {
+  ecoro::helpers::noisy_counter counter;
+
+  auto child = [](ecoro::helpers::noisy) -> ecoro::task<int> { co_return 1; };
+
+  ecoro::sync_wait([&]() -> ecoro::task<void> {
+    auto [a, b] = co_await ecoro::when_all_results(
+        child(ecoro::helpers::noisy{&counter}),
+        child(ecoro::helpers::noisy{&counter}));
+
+    // Nothing of the child frames is alive while the results are in use.
+    EXPECT_EQ(counter.ctor + counter.ctor_copy + counter.ctor_move,
+              counter.dtor);
+    EXPECT_EQ(a + b, 2);
+  });
+}
+
+TEST(when_all, results_exception) {
+  auto fail = []() -> ecoro::task<int> {
+    throw std::runtime_error{"failed"};
+    co_return 0;
+  };
+
+  auto ok = []() -> ecoro::task<int> { co_return 1; };
+
+  EXPECT_THROW(ecoro::sync_wait(ecoro::when_all_results(ok, fail)),
+               std::runtime_error);
+}
+
+TEST(when_all, results_on_thread_pool) {
+  ecoro::thread_pool pool{4};
+
+  auto child = [&pool](int value) -> ecoro::task<int> {
+    co_await pool.schedule();
+    co_return value;
+  };
+
+  for (int i = 0; i < 1'000; ++i) {
+    auto [a, b, c] = ecoro::sync_wait(
+        ecoro::when_all_results(child(1), child(2), child(3)));
+    EXPECT_EQ(a + b + c, 6);
+  }
+}
+
+TEST(when_all, results_cancelled_child) {
+  using namespace std::chrono_literals;
+
+  ecoro::thread_pool pool{2};
+  ecoro::helpers::noisy_counter counter;
+  ecoro::stop_source source;
+  source.request_stop_after(pool, 10ms);
+
+  auto sleeper = [](ecoro::helpers::noisy) -> ecoro::task<int> {
+    co_await ecoro::this_coro::sleep_for(2s);
+    co_return 1;
+  };
+
+  auto ok = [](ecoro::helpers::noisy) -> ecoro::task<int> { co_return 2; };
+
+  auto make_run = [&]() -> ecoro::task<void> {
+    co_await ecoro::when_all_results(sleeper(ecoro::helpers::noisy{&counter}),
+                                     ok(ecoro::helpers::noisy{&counter}));
+  };
+  auto run = make_run();
+  run.set_scheduler(&pool);
+  run.set_stop_token(source.get_token());
+
+  // The cancelled child unwinds, so every child frame is gone too.
+  EXPECT_THROW(ecoro::sync_wait(run), ecoro::operation_cancelled);
+  EXPECT_EQ(counter.ctor + counter.ctor_copy + counter.ctor_move,
+            counter.dtor);
+}
+
+TEST(when_all, inherit_stop_token) {
+  ecoro::stop_source source;
+
+  auto child = []() -> ecoro::task<bool> {
+    const auto token = co_await ecoro::this_coro::stop_token();
+    co_return token.stop_possible();
+  };
+
+  auto make_run = [&child]() -> ecoro::task<void> {
+    auto [a, b] = co_await ecoro::when_all_results(child(), child());
+    EXPECT_TRUE(a);
+    EXPECT_TRUE(b);
+
+    auto [c] = co_await ecoro::when_all(child());
+    EXPECT_TRUE(c.result());
+
+    std::vector<ecoro::task<bool>> tasks;
+    tasks.push_back(child());
+    const auto results = co_await ecoro::when_all(std::move(tasks));
+    EXPECT_TRUE(results[0]);
+  };
+  auto run = make_run();
+  run.set_stop_token(source.get_token());
+
+  ecoro::sync_wait(run);
+}
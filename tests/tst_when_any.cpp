@@ -5,11 +5,18 @@
 
 #include "ecoro/scope_guard.hpp"
 #include "ecoro/sync_wait.hpp"
+#include "ecoro/this_coro.hpp"
+#include "ecoro/thread_pool.hpp"
+#include "ecoro/until_stopped.hpp"
 #include "ecoro/when_any.hpp"
 
 #include "gtest/gtest.h"
 
+#include <atomic>
+#include <chrono>
+#include <thread>
 #include <vector>
+#include <stdexcept>
 #include <string_view>
 
 TEST(when_any, sanity_check) {
@@ -102,3 +109,289 @@ TEST(when_any, second_finish) {
     co_return;
   });
 }
+
+TEST(when_any, stop_token_of_losers) {
+  ecoro::sync_wait([]() -> ecoro::task<void> {
+    ecoro::stop_token loser_token;
+
+    auto loser = [&loser_token]() -> ecoro::task<void> {
+      loser_token = co_await ecoro::this_coro::stop_token();
+      co_await ecoro::until_stopped(loser_token);
+    };
+
+    auto winner = []() -> ecoro::task<int> { co_return 1; };
+
+    auto any = ecoro::when_any(loser(), winner());
+    auto res = co_await any;
+
+    EXPECT_EQ(res.index, 1);
+    EXPECT_TRUE(loser_token.stop_requested());
+  });
+}
+
+TEST(when_any, cancel_losing_timer) {
+  using namespace std::chrono_literals;
+
+  ecoro::thread_pool pool{2};
+  std::atomic<bool> loser_resumed{false};
+  std::atomic<bool> loser_unwound{false};
+
+  auto make_run = [&]() -> ecoro::task<std::size_t> {
+    auto loser = [&loser_resumed, &loser_unwound]() -> ecoro::task<void> {
+      ecoro::scope_guard guard{[&loser_unwound] { loser_unwound = true; }};
+      co_await ecoro::this_coro::sleep_for(20ms);
+      loser_resumed = true;
+    };
+
+    auto winner = [&pool]() -> ecoro::task<void> {
+      co_await pool.schedule();
+    };
+
+    auto res = co_await ecoro::when_any(loser(), winner());
+    co_return res.index;
+  };
+  auto run = make_run();
+  run.set_scheduler(&pool);
+
+  EXPECT_EQ(ecoro::sync_wait(run), 1);
+
+  // The cancelled sleep throws, so the loser unwinds without going on.
+  while (!loser_unwound.load()) {
+    std::this_thread::yield();
+  }
+  EXPECT_FALSE(loser_resumed.load());
+}
+
+TEST(when_any, concurrent_completion) {
+  using namespace std::chrono_literals;
+
+  ecoro::thread_pool pool{4};
+  std::atomic<int> started{0};
+  std::atomic<int> finished{0};
+
+  // Every child waits for the others to start, then they race to finish.
+  auto child = [&pool, &started, &finished]() -> ecoro::task<void> {
+    started.fetch_add(1);
+    co_await pool.schedule();
+    while (started.load() < 4) {
+      std::this_thread::yield();
+    }
+    finished.fetch_add(1);
+  };
+
+  for (int i = 0; i < 200; ++i) {
+    started = 0;
+    finished = 0;
+    std::atomic<int> resumed{0};
+
+    auto run = [&]() -> ecoro::task<void> {
+      auto any = ecoro::when_any(child(), child(), child(), child());
+      auto res = co_await any;
+      resumed.fetch_add(1);
+      EXPECT_LT(res.index, 4);
+
+      // Late finishers must be done before the test moves on.
+      while (finished.load() < 4) {
+        std::this_thread::yield();
+      }
+    };
+
+    ecoro::sync_wait(run);
+    EXPECT_EQ(resumed.load(), 1);
+  }
+}
+
+TEST(when_any, range) {
+  ecoro::sync_wait([]() -> ecoro::task<void> {
+    auto pending = []() -> ecoro::task<int> {
+      co_await ecoro::until_stopped(co_await ecoro::this_coro::stop_token());
+      co_return 0;
+    };
+
+    auto ready = [](int value) -> ecoro::task<int> { co_return value; };
+
+    std::vector<ecoro::task<int>> tasks;
+    tasks.push_back(pending());
+    tasks.push_back(ready(42));
+    tasks.push_back(ready(7));
+
+    auto res = co_await ecoro::when_any(std::move(tasks));
+    EXPECT_EQ(res.index, 1);
+    EXPECT_EQ(res.value, 42);
+  });
+}
+
+TEST(when_any, range_void) {
+  auto ready = []() -> ecoro::task<void> { co_return; };
+
+  std::vector<ecoro::task<void>> tasks;
+  tasks.push_back(ready());
+
+  const auto res = ecoro::sync_wait(ecoro::when_any(std::move(tasks)));
+  EXPECT_EQ(res.index, 0);
+}
+
+TEST(when_any, range_empty) {
+  EXPECT_THROW(ecoro::when_any(std::vector<ecoro::task<int>>{}),
+               std::invalid_argument);
+}
+
+TEST(when_any, range_hedged_requests) {
+  using namespace std::chrono_literals;
+
+  ecoro::thread_pool pool{2};
+  std::atomic<int> resumed{0};
+  std::atomic<int> unwound{0};
+
+  auto replica = [&resumed, &unwound](std::chrono::milliseconds delay,
+                                      int id) -> ecoro::task<int> {
+    ecoro::scope_guard guard{[&unwound] { unwound.fetch_add(1); }};
+    co_await ecoro::this_coro::sleep_for(delay);
+    resumed.fetch_add(1);
+    co_return id;
+  };
+
+  auto make_run = [&]() -> ecoro::task<int> {
+    std::vector<ecoro::task<int>> tasks;
+    tasks.push_back(replica(200ms, 0));
+    tasks.push_back(replica(5ms, 1));
+    tasks.push_back(replica(300ms, 2));
+
+    auto res = co_await ecoro::when_any(std::move(tasks));
+    co_return res.value;
+  };
+  auto run = make_run();
+  run.set_scheduler(&pool);
+
+  const auto started = std::chrono::steady_clock::now();
+  EXPECT_EQ(ecoro::sync_wait(run), 1);
+  EXPECT_LT(std::chrono::steady_clock::now() - started, 200ms);
+
+  // The slow replicas were cancelled, their timers never fire.
+  while (unwound.load() < 3) {
+    std::this_thread::yield();
+  }
+  EXPECT_EQ(resumed.load(), 1);
+}
+
+TEST(when_any, parent_stop_reaches_children) {
+  using namespace std::chrono_literals;
+
+  ecoro::thread_pool pool{2};
+  ecoro::stop_source source;
+  std::atomic<int> resumed{0};
+  std::atomic<int> unwound{0};
+
+  auto sleeper = [&resumed, &unwound]() -> ecoro::task<int> {
+    ecoro::scope_guard guard{[&unwound] { unwound.fetch_add(1); }};
+    co_await ecoro::this_coro::sleep_for(2s);
+    resumed.fetch_add(1);
+    co_return 0;
+  };
+
+  auto make_run = [&]() -> ecoro::task<void> {
+    // Both sleeps are cancelled, whichever resumes first wins.
+    auto res = co_await ecoro::when_any(sleeper(), sleeper());
+    if (res.index == 0) {
+      EXPECT_THROW(std::get<0>(res.awaitables).result(),
+                   ecoro::operation_cancelled);
+    } else {
+      EXPECT_THROW(std::get<1>(res.awaitables).result(),
+                   ecoro::operation_cancelled);
+    }
+  };
+  auto run = make_run();
+  run.set_scheduler(&pool);
+  run.set_stop_token(source.get_token());
+
+  std::thread canceller{[&source] {
+    std::this_thread::sleep_for(10ms);
+    source.request_stop();
+  }};
+
+  ecoro::sync_wait(run);
+  canceller.join();
+  while (unwound.load() < 2) {
+    std::this_thread::yield();
+  }
+  EXPECT_EQ(resumed.load(), 0);
+}
+
+TEST(when_any, result_destroyed_right_away) {
+  ecoro::thread_pool pool{4};
+  std::atomic<int> started{0};
+  std::atomic<int> unwound{0};
+
+  // The losers are still running or queued on other workers when the
+  // winner finishes, the result goes away as soon as the parent resumes.
+  auto spinner = [&pool, &started, &unwound]() -> ecoro::task<int> {
+    started.fetch_add(1);
+    ecoro::scope_guard guard{[&unwound] { unwound.fetch_add(1); }};
+    const auto token = co_await ecoro::this_coro::stop_token();
+    while (!token.stop_requested()) {
+      co_await pool.schedule();
+    }
+    co_return 0;
+  };
+
+  auto winner = [&pool]() -> ecoro::task<int> {
+    co_await pool.schedule();
+    co_return 1;
+  };
+
+  auto make_run = [&]() -> ecoro::task<std::size_t> {
+    co_return (co_await ecoro::when_any(spinner(), winner(), spinner(),
+                                        spinner()))
+        .index;
+  };
+
+  for (int i = 0; i < 200; ++i) {
+    auto run = make_run();
+    run.set_scheduler(&pool);
+    EXPECT_EQ(ecoro::sync_wait(run), 1);
+  }
+
+  // The spinners that were started see the stop and unwind on their own.
+  while (unwound.load() < started.load()) {
+    std::this_thread::yield();
+  }
+}
+
+TEST(when_any, range_result_destroyed_right_away) {
+  ecoro::thread_pool pool{4};
+  std::atomic<int> started{0};
+  std::atomic<int> unwound{0};
+
+  auto spinner = [&pool, &started, &unwound]() -> ecoro::task<int> {
+    started.fetch_add(1);
+    ecoro::scope_guard guard{[&unwound] { unwound.fetch_add(1); }};
+    const auto token = co_await ecoro::this_coro::stop_token();
+    while (!token.stop_requested()) {
+      co_await pool.schedule();
+    }
+    co_return 0;
+  };
+
+  auto winner = [&pool]() -> ecoro::task<int> {
+    co_await pool.schedule();
+    co_return 1;
+  };
+
+  auto make_run = [&]() -> ecoro::task<int> {
+    std::vector<ecoro::task<int>> tasks;
+    tasks.push_back(spinner());
+    tasks.push_back(winner());
+    tasks.push_back(spinner());
+    co_return (co_await ecoro::when_any(std::move(tasks))).value;
+  };
+
+  for (int i = 0; i < 200; ++i) {
+    auto run = make_run();
+    run.set_scheduler(&pool);
+    EXPECT_EQ(ecoro::sync_wait(run), 1);
+  }
+
+  while (unwound.load() < started.load()) {
+    std::this_thread::yield();
+  }
+}
@@ -5,10 +5,15 @@
 
 #include "ecoro/scope_guard.hpp"
 #include "ecoro/sync_wait.hpp"
+#include "ecoro/this_coro.hpp"
+#include "ecoro/thread_pool.hpp"
 #include "ecoro/when_first.hpp"
 
 #include "gtest/gtest.h"
 
+#include <atomic>
+#include <thread>
+
 TEST(when_first, sanity_check) {
   auto t1 = []() -> ecoro::task<int> {
     co_return 10;
@@ -96,3 +101,63 @@ TEST(when_first, second_finish) {
     co_return;
   });
 }
+
+TEST(when_first, timeout) {
+  using namespace std::chrono_literals;
+
+  ecoro::thread_pool pool{2};
+
+  auto run = []() -> ecoro::task<std::optional<int>> {
+    auto slow = []() -> ecoro::task<int> {
+      co_await ecoro::this_coro::sleep_for(10s);
+      co_return 1;
+    };
+
+    auto timeout = []() -> ecoro::task<void> {
+      co_await ecoro::this_coro::sleep_for(10ms);
+    };
+
+    co_return co_await ecoro::when_first(slow(), timeout());
+  }();
+  run.set_scheduler(&pool);
+
+  const auto started = std::chrono::steady_clock::now();
+  EXPECT_FALSE(ecoro::sync_wait(run).has_value());
+  EXPECT_LT(std::chrono::steady_clock::now() - started, 5s);
+}
+
+TEST(when_first, busy_loser_on_one_worker) {
+  using namespace std::chrono_literals;
+
+  ecoro::thread_pool pool{1};
+  std::atomic<int> unwound{0};
+
+  // The loser is queued behind the timer when the timeout wins, it unwinds
+  // after the when_first has returned.
+  auto busy_yield_loop = [&unwound]() -> ecoro::task<int> {
+    ecoro::scope_guard guard{[&unwound] { unwound.fetch_add(1); }};
+    const auto token = co_await ecoro::this_coro::stop_token();
+    while (!token.stop_requested()) {
+      co_await ecoro::this_coro::yield();
+    }
+    co_return 1;
+  };
+
+  auto timeout = []() -> ecoro::task<void> {
+    co_await ecoro::this_coro::sleep_for(5ms);
+  };
+
+  auto make_run = [&]() -> ecoro::task<std::optional<int>> {
+    co_return co_await ecoro::when_first(busy_yield_loop(), timeout());
+  };
+
+  for (int i = 0; i < 20; ++i) {
+    auto task = make_run();
+    task.set_scheduler(&pool);
+    EXPECT_FALSE(ecoro::sync_wait(task).has_value());
+  }
+
+  while (unwound.load() < 20) {
+    std::this_thread::yield();
+  }
+}
@@ -0,0 +1,197 @@
+// Copyright 2022 - present, Mikhail Svetkin
+// All rights reserved.
+//
+// For the license information refer to LICENSE
+
+#include "ecoro/manual_reset_event.hpp"
+#include "ecoro/scope_guard.hpp"
+#include "ecoro/sync_wait.hpp"
+#include "ecoro/this_coro.hpp"
+#include "ecoro/thread_pool.hpp"
+#include "ecoro/until_stopped.hpp"
+#include "ecoro/when_n.hpp"
+
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Finishes only once the when_n cancels it.
+ecoro::task<int> pending() {
+  co_await ecoro::until_stopped(co_await ecoro::this_coro::stop_token());
+  co_return 0;
+}
+
+ecoro::task<int> ready(int value) {
+  co_return value;
+}
+
+ecoro::task<int> failing() {
+  throw std::runtime_error{"replica is down"};
+  co_return 0;
+}
+
+}  // namespace
+
+TEST(when_n, sanity_check) {
+  auto t1 = []() -> ecoro::task<int> { co_return 10; };
+  auto t2 = []() -> ecoro::task<char> { co_return 'e'; };
+  auto t3 = []() -> ecoro::task<void> { co_return; };
+
+  auto [indexes, awaitables] =
+      ecoro::sync_wait(ecoro::when_n(2, t1(), t2(), t3()));
+  EXPECT_EQ(indexes, (std::vector<std::size_t>{0, 1}));
+  EXPECT_EQ(std::get<0>(awaitables).result(), 10);
+  EXPECT_EQ(std::get<1>(awaitables).result(), 'e');
+  EXPECT_FALSE(std::get<2>(awaitables).done());
+}
+
+TEST(when_n, quorum_out_of_range) {
+  EXPECT_THROW(ecoro::when_n(0, ready(1)), std::invalid_argument);
+  EXPECT_THROW(ecoro::when_n(2, ready(1)), std::invalid_argument);
+
+  std::vector<ecoro::task<int>> tasks;
+  tasks.push_back(ready(1));
+  EXPECT_THROW(ecoro::when_n(2, std::move(tasks)), std::invalid_argument);
+}
+
+TEST(when_n, range) {
+  ecoro::sync_wait([]() -> ecoro::task<void> {
+    std::vector<ecoro::task<int>> tasks;
+    tasks.push_back(pending());
+    tasks.push_back(ready(1));
+    tasks.push_back(pending());
+    tasks.push_back(ready(3));
+    tasks.push_back(ready(4));
+
+    const auto results = co_await ecoro::when_n(2, std::move(tasks));
+    EXPECT_EQ(results.size(), 2);
+    EXPECT_EQ(results[0].index, 1);
+    EXPECT_EQ(results[0].value, 1);
+    EXPECT_EQ(results[1].index, 3);
+    EXPECT_EQ(results[1].value, 3);
+  });
+}
+
+TEST(when_n, failures_do_not_count) {
+  std::vector<ecoro::task<int>> tasks;
+  tasks.push_back(failing());
+  tasks.push_back(ready(1));
+  tasks.push_back(ready(2));
+
+  const auto results = ecoro::sync_wait(ecoro::when_n(2, std::move(tasks)));
+  ASSERT_EQ(results.size(), 2);
+  EXPECT_EQ(results[0].index, 1);
+  EXPECT_EQ(results[1].index, 2);
+}
+
+TEST(when_n, quorum_unreachable) {
+  std::vector<ecoro::task<int>> tasks;
+  tasks.push_back(failing());
+  tasks.push_back(ready(1));
+  tasks.push_back(failing());
+  tasks.push_back(pending());
+
+  EXPECT_THROW(ecoro::sync_wait(ecoro::when_n(3, std::move(tasks))),
+               std::runtime_error);
+
+  EXPECT_THROW(ecoro::sync_wait(ecoro::when_n(3, failing(), ready(1), failing(),
+                                              pending())),
+               std::runtime_error);
+}
+
+TEST(when_n, range_void) {
+  auto done = []() -> ecoro::task<void> { co_return; };
+
+  std::vector<ecoro::task<void>> tasks;
+  tasks.push_back(done());
+  tasks.push_back(done());
+
+  const auto results = ecoro::sync_wait(ecoro::when_n(2, std::move(tasks)));
+  ASSERT_EQ(results.size(), 2);
+  EXPECT_EQ(results[1].index, 1);
+}
+
+TEST(when_n, quorum_of_replicas) {
+  using namespace std::chrono_literals;
+
+  ecoro::thread_pool pool{4};
+  std::atomic<int> resumed{0};
+  std::atomic<int> unwound{0};
+
+  auto replica = [&resumed, &unwound](std::chrono::milliseconds delay,
+                                      int id) -> ecoro::task<int> {
+    ecoro::scope_guard guard{[&unwound] { unwound.fetch_add(1); }};
+    co_await ecoro::this_coro::sleep_for(delay);
+    resumed.fetch_add(1);
+    co_return id;
+  };
+
+  auto make_run = [&]() -> ecoro::task<std::size_t> {
+    std::vector<ecoro::task<int>> tasks;
+    tasks.push_back(replica(300ms, 0));
+    tasks.push_back(replica(5ms, 1));
+    tasks.push_back(replica(10ms, 2));
+    tasks.push_back(replica(300ms, 3));
+    tasks.push_back(replica(1ms, 4));
+
+    const auto results = co_await ecoro::when_n(3, std::move(tasks));
+    std::size_t ids = 0;
+    for (const auto &r : results) {
+      ids |= std::size_t{1} << r.value;
+    }
+    co_return ids;
+  };
+  auto run = make_run();
+  run.set_scheduler(&pool);
+
+  const auto started = std::chrono::steady_clock::now();
+  EXPECT_EQ(ecoro::sync_wait(run), 0b10110);
+  EXPECT_LT(std::chrono::steady_clock::now() - started, 300ms);
+
+  // The two slowest replicas were cancelled, their timers never fire.
+  while (unwound.load() < 5) {
+    std::this_thread::yield();
+  }
+  EXPECT_EQ(resumed.load(), 3);
+}
+
+TEST(when_n, quorum_does_not_wait_for_losers) {
+  ecoro::manual_reset_event stuck;
+  int unwound = 0;
+
+  // Ignores the stop token, so it finishes only once the event is set.
+  auto blocked = [&stuck, &unwound]() -> ecoro::task<int> {
+    co_await stuck;
+    ++unwound;
+    co_return 0;
+  };
+
+  {
+    std::vector<ecoro::task<int>> tasks;
+    tasks.push_back(blocked());
+    tasks.push_back(ready(1));
+    tasks.push_back(blocked());
+    tasks.push_back(ready(2));
+
+    const auto results = ecoro::sync_wait(ecoro::when_n(2, std::move(tasks)));
+    ASSERT_EQ(results.size(), 2);
+    EXPECT_EQ(results[0].value + results[1].value, 3);
+  }
+
+  {
+    auto [indexes, awaitables] = ecoro::sync_wait(
+        ecoro::when_n(2, blocked(), ready(1), blocked(), ready(2)));
+    EXPECT_EQ(indexes, (std::vector<std::size_t>{1, 3}));
+  }
+
+  // The losers outlive the when_n and free their frames once they finish.
+  EXPECT_EQ(unwound, 0);
+  stuck.set();
+  EXPECT_EQ(unwound, 4);
+}